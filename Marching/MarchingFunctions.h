@@ -114,7 +114,8 @@ namespace RayMarchFunctions
 	
 	//////////////////////////////////////////////////////////////////////////
 	
-	template <typename N, typename SpaceTransformationMatrix_t = glm::mat<N::length(), N::length(), float, glm::defaultp>>
+	// HIT_ATTRIBUTES is a mask of Configuration::HitAttributes. Attributes that are not requested are left zero in the result.
+	template <typename N, typename SpaceTransformationMatrix_t = glm::mat<N::length(), N::length(), float, glm::defaultp>, unsigned int HIT_ATTRIBUTES = Configuration::HitAttribute_All>
 	A_CUDA_CPUGPU static RayMarchResult<N> MarchSingleBiRay(const Math::BiRay<N>& biRay, const SpaceTransformationMatrix_t& biRaySpaceToWorldSpace, const RenderSceneDataCUDA* renderSceneData, const float minStepDistance, const float maxDistance, const unsigned int maxSteps, const float rayHitEpsilon)
 	{
 		// WS = World Space
@@ -134,6 +135,10 @@ namespace RayMarchFunctions
 		DimVector closestOnRayPositionWS;
 		float closestDistanceWS			= 12345.0f;
 
+		// After the first step, the cone already evaluated the distance at the current position.
+		bool isDistanceKnown			= false;
+		float knownDistanceWS			= 0.0f;
+
 		unsigned int stepCount		= 0;
 
 		while (true)
@@ -147,8 +152,9 @@ namespace RayMarchFunctions
 			const DimVector rayPositionWS = biRay.At(traversedDistanceMainTBS, traversedDistanceSecTBS);
 
 			// Sample closest surface
-			float closestSurfaceDistanceWS;
-			const DimVector closestSurfaceVectorWSNormalized = renderSceneData->EvaluateToSurfaceVectorZW(rayPositionWS, closestSurfaceDistanceWS);	
+			float closestSurfaceDistanceWS = knownDistanceWS;
+			const DimVector closestSurfaceVectorWSNormalized = isDistanceKnown ? renderSceneData->EvaluateToSurfaceVectorZWFromDistance(rayPositionWS, knownDistanceWS) 
+																			   : renderSceneData->EvaluateToSurfaceVectorZW(rayPositionWS, closestSurfaceDistanceWS);	
 
 			// Assess closest surface vector
 			const DimVector closestSurfacePositionWS = rayPositionWS + closestSurfaceDistanceWS * closestSurfaceVectorWSNormalized;
@@ -215,10 +221,25 @@ namespace RayMarchFunctions
 						traversedDistanceMainTBS					= currentHitPositionTBS.z;
 						traversedDistanceSecTBS						= currentHitPositionTBS.w;
 	
-						const DimVector hitPositionOS				= renderSceneData->GetLocalSamplePosition(currentHitPositionWS);
-						const DimVector normalWS					= renderSceneData->EvaluateNormal(currentHitPositionWS + normalEvaluationBias);
-						const DimVector floatingHitPositionOS		= renderSceneData->GetLocalSamplePosition(currentHitPositionWS + normalWS);
-						const DimVector normalOS					= glm::normalize(floatingHitPositionOS - hitPositionOS);						
+						constexpr bool NEEDS_LOCAL_POSITION			= (HIT_ATTRIBUTES & Configuration::HitAttribute_LocalPosition) != 0;
+						constexpr bool NEEDS_NORMAL					= (HIT_ATTRIBUTES & Configuration::HitAttribute_Normal) != 0;
+
+						DimVector hitPositionOS						= DimVector();
+						DimVector normalWS							= DimVector();
+						DimVector normalOS							= DimVector();
+						if constexpr (NEEDS_LOCAL_POSITION)
+						{
+							hitPositionOS							= renderSceneData->GetLocalSamplePosition(currentHitPositionWS);
+						}
+						if constexpr (NEEDS_NORMAL)
+						{
+							normalWS								= renderSceneData->EvaluateNormal(currentHitPositionWS + normalEvaluationBias);
+						}
+						if constexpr (NEEDS_LOCAL_POSITION && NEEDS_NORMAL)
+						{
+							const DimVector floatingHitPositionOS	= renderSceneData->GetLocalSamplePosition(currentHitPositionWS + normalWS);
+							normalOS								= glm::normalize(floatingHitPositionOS - hitPositionOS);
+						}
 
 						// We are at the end of the edge. This is where we return!
 						return RayMarchResult<DimVector>(true, currentTestDistanceWS, stepCount, traversedDistanceMainTBS, traversedDistanceSecTBS, currentHitPositionWS, hitPositionOS, currentHitPositionWS, normalWS, normalOS);
@@ -343,21 +364,26 @@ namespace RayMarchFunctions
 			////////////////////////////////////////////////////////////////////////
 			// 5) Perform Step
 
+			// The traversed distances are summed up exactly like the cone positions above, so the next position is the chosen one.
 			if (isLeftClosest)
 			{
 				traversedDistanceMainTBS	+= moveVectorConeLeftBS.x;
 				traversedDistanceSecTBS		+= moveVectorConeLeftBS.y;
+				knownDistanceWS				= distanceConeLeft;
 			}
 			else if (isMiddleClosest)
 			{
 				traversedDistanceMainTBS	+= moveVectorConeMiddleBS.x;
 				traversedDistanceSecTBS		+= moveVectorConeMiddleBS.y;
+				knownDistanceWS				= distanceConeMiddle;
 			}
 			else
 			{
 				traversedDistanceMainTBS	+= moveVectorConeRightBS.x;
 				traversedDistanceSecTBS		+= moveVectorConeRightBS.y;
+				knownDistanceWS				= distanceConeRight;
 			}
+			isDistanceKnown = true;
 		}
 
 		// RESULT
@@ -369,6 +395,41 @@ namespace RayMarchFunctions
 
 	//////////////////////////////////////////////////////////////////////////
 
+	// Same result as MarchSingleBiRay for scenes that RenderSceneDataCUDA::IsAnalytic, but exact and without any steps or edge walk.
+	template <unsigned int HIT_ATTRIBUTES = Configuration::HitAttribute_All>
+	A_CUDA_CPUGPU static RayMarchResult<glm::vec4> IntersectSingleBiRay(const Math::BiRay<glm::vec4>& biRay, const RenderSceneDataCUDA* renderSceneData, const float maxDistance)
+	{
+		Math::BiRayHit hit;
+		if (!renderSceneData->IntersectAnalytic(biRay, maxDistance, hit))
+		{
+			return RayMarchResult<glm::vec4>();
+		}
+
+		constexpr bool NEEDS_LOCAL_POSITION	= (HIT_ATTRIBUTES & Configuration::HitAttribute_LocalPosition) != 0;
+		constexpr bool NEEDS_NORMAL			= (HIT_ATTRIBUTES & Configuration::HitAttribute_Normal) != 0;
+
+		glm::vec4 hitPositionOS				= glm::vec4();
+		glm::vec4 normalWS					= glm::vec4();
+		glm::vec4 normalOS					= glm::vec4();
+		if constexpr (NEEDS_LOCAL_POSITION)
+		{
+			hitPositionOS					= renderSceneData->GetLocalSamplePosition(hit.Position);
+		}
+		if constexpr (NEEDS_NORMAL)
+		{
+			normalWS						= hit.Normal;
+		}
+		if constexpr (NEEDS_LOCAL_POSITION && NEEDS_NORMAL)
+		{
+			const glm::vec4 floatingHitPositionOS	= renderSceneData->GetLocalSamplePosition(hit.Position + normalWS);
+			normalOS						= glm::normalize(floatingHitPositionOS - hitPositionOS);
+		}
+
+		return RayMarchResult<glm::vec4>(true, 0.0f, 0, hit.TraversedMain, hit.TraversedSecondary, hit.Position, hitPositionOS, hit.Position, normalWS, normalOS);
+	}
+
+	//////////////////////////////////////////////////////////////////////////
+
 	#pragma optimize( "", off )
 	// Note that this debug implementation does not support templates anymore, as static templates can not be individually marked as "do not optimize".
 	static RayMarchResult<glm::vec4> MarchSingleBiRay_DEBUG(const Math::BiRay<glm::vec4>& biRay, const glm::mat<4, 4, float, glm::defaultp>& biRaySpaceToWorldSpace, 
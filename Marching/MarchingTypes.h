@@ -3,7 +3,10 @@
 #include "GraphicsIncludes.h"
 #include <Vendor/imgui/imgui.h>
 
+#include <cstring>
 #include <functional>
+
+#include "MathLib/Functions/Core.h"
 #include "Rendering/CUDATypes.h"
 
 //////////////////////////////////////////////////////////////////////////
@@ -31,11 +34,12 @@ struct ResultColor
 
 	//////////////////////////////////////////////////////////////////////////
 
+	// Saturates, as light amounts above one brighten the color.
 	A_CUDA_CPUGPU ResultColor operator *(const float factor) const
 	{
-		return {static_cast<BufferType>(Red * factor), 
-				static_cast<BufferType>(Green * factor), 
-				static_cast<BufferType>(Blue * factor), 
+		return {static_cast<BufferType>(Math::Min(Red * factor, 255.0f)), 
+				static_cast<BufferType>(Math::Min(Green * factor, 255.0f)), 
+				static_cast<BufferType>(Math::Min(Blue * factor, 255.0f)), 
 				Alpha};
 	}
 
@@ -66,6 +70,7 @@ struct RayMarchResult
 	N					LocalNormal = N();
 
 	float				ShadowValue = 0.0f;
+	float				AmbientOcclusion = 1.0f;
 	
 	float				TraversedPrimary = 0.0f;
 	float				TraversedSecondary = 0.0f;
@@ -75,6 +80,189 @@ struct RayMarchResult
 	A_CUDA_CPUGPU explicit RayMarchResult(const bool hit, const float distance, const unsigned int steps, const float traversedPrimary, const float traversedSecondary, const N& position, const N& localPosition, const N& closestPosition, const N& normal, const N& localNormal)	: Hit(hit), Steps(steps), SignedDistance(distance), TraversedPrimary(traversedPrimary), TraversedSecondary(traversedSecondary), Position(position), LocalPosition(localPosition), ClosestPosition(closestPosition), Normal(normal), LocalNormal(localNormal) {}
 };
 
+//////////////////////////////////////////////////////////////////////////
+
+// Compact storage variant of RayMarchResult<glm::vec4> for per-pixel buffers (48 instead of ~112 bytes).
+// - Position stays at full precision, as shadow rays start there.
+// - Normals take 32 bit each, see PackNormal. Local position, distance and depths are stored as fp16 bit patterns.
+// - TraversedPrimary is stored relative to a depth reference (usually the view pane distance), which keeps it in the precise range of fp16.
+// - Steps and flags share a single word. ClosestPosition is only needed while marching and is not stored.
+// - The shadow value is the light amount of all lights at the hit. It is stored as unorm16 over [0, MAX_LIGHT_AMOUNT], so that the additional
+//   lights can brighten surfaces that the key light already lights fully.
+struct PackedRayMarchResult
+{
+	enum Flags : unsigned int
+	{
+		Flag_Hit			= 1 << 0,
+	};
+
+	static constexpr unsigned int STEPS_BITS	= 24;
+	static constexpr unsigned int STEPS_MASK	= (1u << STEPS_BITS) - 1;
+	static constexpr float MAX_LIGHT_AMOUNT		= 4.0f;
+
+	glm::vec4			Position			= glm::vec4();
+	unsigned short		LocalPosition[4]	= {};
+	unsigned int		Normal				= 0;
+	unsigned int		LocalNormal			= 0;
+	unsigned int		StepsAndFlags		= 0;
+	unsigned short		TraversedPrimary	= 0;
+	unsigned short		TraversedSecondary	= 0;
+	unsigned short		SignedDistance		= 0;
+	unsigned short		ShadowValue			= 0;
+	unsigned short		AmbientOcclusion	= 65535;
+
+	A_CUDA_CPUGPU PackedRayMarchResult() = default;
+	A_CUDA_CPUGPU explicit PackedRayMarchResult(const RayMarchResult<glm::vec4>& result, const float depthReference)
+	{
+		Position			= result.Position;
+		PackHalf4(result.LocalPosition, LocalPosition);
+		Normal				= PackNormal(result.Normal);
+		LocalNormal			= PackNormal(result.LocalNormal);
+		TraversedPrimary	= PackHalf(result.TraversedPrimary - depthReference);
+		TraversedSecondary	= PackHalf(result.TraversedSecondary);
+		SignedDistance		= PackHalf(result.SignedDistance);
+		SetShadowValue(result.ShadowValue);
+		SetAmbientOcclusion(result.AmbientOcclusion);
+		StepsAndFlags		= (result.Steps < STEPS_MASK ? result.Steps : STEPS_MASK) | ((result.Hit ? Flag_Hit : 0) << STEPS_BITS);
+	}
+
+	A_CUDA_CPUGPU RayMarchResult<glm::vec4> ToRayMarchResult(const float depthReference) const
+	{
+		RayMarchResult<glm::vec4> result;
+		result.Hit					= IsHit();
+		result.Steps				= GetSteps();
+		result.SignedDistance		= UnpackHalf(SignedDistance);
+		result.Position				= Position;
+		result.ClosestPosition		= Position;
+		result.LocalPosition		= UnpackHalf4(LocalPosition);
+		result.Normal				= UnpackNormal(Normal);
+		result.LocalNormal			= UnpackNormal(LocalNormal);
+		result.ShadowValue			= GetShadowValue();
+		result.AmbientOcclusion		= GetAmbientOcclusion();
+		result.TraversedPrimary		= UnpackHalf(TraversedPrimary) + depthReference;
+		result.TraversedSecondary	= UnpackHalf(TraversedSecondary);
+		return result;
+	}
+
+	A_CUDA_CPUGPU unsigned int GetFlags() const					{ return StepsAndFlags >> STEPS_BITS; }
+	A_CUDA_CPUGPU unsigned int GetSteps() const					{ return StepsAndFlags & STEPS_MASK; }
+	A_CUDA_CPUGPU bool IsHit() const							{ return (GetFlags() & Flag_Hit) != 0; }
+	A_CUDA_CPUGPU glm::vec4 GetNormal() const					{ return UnpackNormal(Normal); }
+	A_CUDA_CPUGPU glm::vec4 GetLocalPosition() const			{ return UnpackHalf4(LocalPosition); }
+	A_CUDA_CPUGPU float GetTraversedPrimary(const float depthReference) const	{ return UnpackHalf(TraversedPrimary) + depthReference; }
+	A_CUDA_CPUGPU float GetTraversedSecondary() const			{ return UnpackHalf(TraversedSecondary); }
+
+	A_CUDA_CPUGPU float GetShadowValue() const					{ return ShadowValue * (MAX_LIGHT_AMOUNT / 65535.0f); }
+	A_CUDA_CPUGPU void SetShadowValue(const float shadowValue)	{ ShadowValue = static_cast<unsigned short>(Math::Clamp01(shadowValue / MAX_LIGHT_AMOUNT) * 65535.0f + 0.5f); }
+	A_CUDA_CPUGPU float GetAmbientOcclusion() const				{ return AmbientOcclusion / 65535.0f; }
+	A_CUDA_CPUGPU void SetAmbientOcclusion(const float value)	{ AmbientOcclusion = static_cast<unsigned short>(Math::Clamp01(value) * 65535.0f + 0.5f); }
+
+	//////////////////////////////////////////////////////////////////////////
+
+private:
+
+	// IEEE fp16 bit patterns. The device converts in hardware, the host path rounds half up and is only used for debugging and tools.
+	A_CUDA_CPUGPU static unsigned short PackHalf(const float value)
+	{
+#ifdef __CUDA_ARCH__
+		unsigned short half;
+		asm("cvt.rn.f16.f32 %0, %1;" : "=h"(half) : "f"(value));
+		return half;
+#else
+		unsigned int bits;
+		memcpy(&bits, &value, sizeof(bits));
+
+		const unsigned int sign		= (bits >> 16) & 0x8000u;
+		const int exponent			= static_cast<int>((bits >> 23) & 0xffu) - 127 + 15;
+		const unsigned int mantissa	= bits & 0x7fffffu;
+		if (exponent >= 31)
+		{
+			// Overflow becomes infinity, NaN stays NaN.
+			const bool isNaN = ((bits >> 23) & 0xffu) == 0xffu && mantissa != 0;
+			return static_cast<unsigned short>(sign | 0x7c00u | (isNaN ? 0x200u : 0u));
+		}
+		if (exponent <= 0)
+		{
+			if (exponent < -10)
+			{
+				return static_cast<unsigned short>(sign);
+			}
+			const unsigned int subnormal	= mantissa | 0x800000u;
+			const int shift					= 14 - exponent;
+			return static_cast<unsigned short>(sign | ((subnormal >> shift) + ((subnormal >> (shift - 1)) & 1u)));
+		}
+		// A carry out of the mantissa correctly moves on to the exponent.
+		return static_cast<unsigned short>(sign | (((static_cast<unsigned int>(exponent) << 10) | (mantissa >> 13)) + ((mantissa >> 12) & 1u)));
+#endif
+	}
+
+	A_CUDA_CPUGPU static float UnpackHalf(const unsigned short half)
+	{
+#ifdef __CUDA_ARCH__
+		float value;
+		asm("cvt.f32.f16 %0, %1;" : "=f"(value) : "h"(half));
+		return value;
+#else
+		const unsigned int sign		= (half & 0x8000u) << 16;
+		const unsigned int exponent	= (half >> 10) & 0x1fu;
+		const unsigned int mantissa	= half & 0x3ffu;
+		if (exponent == 0)
+		{
+			const float subnormal = mantissa * 5.9604645e-8f;	// < 2^-24
+			return sign != 0 ? -subnormal : subnormal;
+		}
+
+		const unsigned int bits = sign | (exponent == 31 ? 0x7f800000u : ((exponent + 112) << 23)) | (mantissa << 13);
+		float value;
+		memcpy(&value, &bits, sizeof(value));
+		return value;
+#endif
+	}
+
+	A_CUDA_CPUGPU static void PackHalf4(const glm::vec4& value, unsigned short* outPacked)
+	{
+		for (int i = 0; i < 4; i++)
+		{
+			outPacked[i] = PackHalf(value[i]);
+		}
+	}
+
+	A_CUDA_CPUGPU static glm::vec4 UnpackHalf4(const unsigned short* packed)
+	{
+		return glm::vec4(UnpackHalf(packed[0]), UnpackHalf(packed[1]), UnpackHalf(packed[2]), UnpackHalf(packed[3]));
+	}
+
+	// 4D counterpart of the octahedral normal encoding: the normal is scaled onto the unit L1 sphere |x| + |y| + |z| + |w| = 1, where w follows
+	// from x, y and z up to its sign. x and y take 10 bits, z 11 bits and the last bit is the sign of w. Zero stays zero, as misses have no normal.
+	A_CUDA_CPUGPU static unsigned int PackNormal(const glm::vec4& normal)
+	{
+		const float length = Math::Abs(normal.x) + Math::Abs(normal.y) + Math::Abs(normal.z) + Math::Abs(normal.w);
+		if (length <= 0.0f)
+		{
+			return 0;
+		}
+
+		const glm::vec4 octahedral	= normal / length;
+		const auto Quantize			= [](const float value, const float maximum) { return static_cast<unsigned int>((value * 0.5f + 0.5f) * maximum + 0.5f); };
+		return Quantize(octahedral.x, 1023.0f) | (Quantize(octahedral.y, 1023.0f) << 10) | (Quantize(octahedral.z, 2047.0f) << 20) | (octahedral.w < 0.0f ? 1u << 31 : 0u);
+	}
+
+	A_CUDA_CPUGPU static glm::vec4 UnpackNormal(const unsigned int packed)
+	{
+		// (-1, -1, -1) is not on the L1 sphere, so no normal packs to zero.
+		if (packed == 0)
+		{
+			return glm::vec4(0.0f);
+		}
+
+		const float x	= (packed & 1023u) / 1023.0f * 2.0f - 1.0f;
+		const float y	= ((packed >> 10) & 1023u) / 1023.0f * 2.0f - 1.0f;
+		const float z	= ((packed >> 20) & 2047u) / 2047.0f * 2.0f - 1.0f;
+		const float w	= Math::Max(1.0f - Math::Abs(x) - Math::Abs(y) - Math::Abs(z), 0.0f);
+		return glm::normalize(glm::vec4(x, y, z, (packed >> 31) != 0 ? -w : w));
+	}
+};
+
 //////////////////////////////////////////////////////////////////////////
 	
 struct RenderingBuffer
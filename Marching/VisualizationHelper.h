@@ -40,6 +40,15 @@ public:
 		return ResultColor{255, 0, 255, 255};
 	}
 
+	//////////////////////////////////////////////////////////////////////////
+
+	// The ambient part of the light is scaled by the ambient occlusion, the direct part by the shadow value.
+	template<typename N>
+	A_CUDA_CPUGPU static float GetLightAmount(const Configuration& config, const RayMarchResult<N>& result)
+	{
+		return config.AMBIENT_LIGHT_AMOUNT * result.AmbientOcclusion + (1.0f - config.AMBIENT_LIGHT_AMOUNT) * result.ShadowValue;
+	}
+
 //////////////////////////////////////////////////////////////////////////
 
 public:
@@ -55,7 +64,7 @@ A_CUDA_CPUGPU static ResultColor GetColorForRayResult_SimpleLit(const Configurat
 	}
 
 	// Shade
-	ResultColor shadedColor = ResultColor{255, 255, 255, 255} * Math::Clamp01(Math::Remap(0.0f, 1.0f, config.AMBIENT_LIGHT_AMOUNT, 1.0f, result.ShadowValue));
+	ResultColor shadedColor = ResultColor{255, 255, 255, 255} * Math::Clamp01(GetLightAmount(config, result));
 
 	// Depth Fog		
 	const float depth					= Math::Clamp01(Math::Remap(-10.0f, 40.0f, 0.0f, 1.0f, result.Position.z + result.Position.w));
@@ -77,7 +86,7 @@ A_CUDA_CPUGPU static ResultColor GetColorForRayResult_SimpleLitSurface(const Con
 	ResultColor shadedColor = GetColorForRayResult_Surfaces(config, result);
 
 	// Shade
-	shadedColor = shadedColor * Math::Clamp01(Math::Remap(0.0f, 1.0f, config.AMBIENT_LIGHT_AMOUNT, 1.0f, result.ShadowValue));
+	shadedColor = shadedColor * Math::Clamp01(GetLightAmount(config, result));
 
 	// Depth Fog		
 	const float depth					= Math::Clamp01(Math::Remap(-10.0f, 40.0f, 0.0f, 1.0f, result.Position.z + result.Position.w));
@@ -138,7 +147,7 @@ private:
 			ResultColor surfaceColor	= GetColorForRayResult_Surfaces(config, result);
 			baseColor					= baseColor * 0.5f + surfaceColor * 0.5f;
 		}
-		shadedColor = baseColor * Math::Remap(0.0f, 1.0f, config.AMBIENT_LIGHT_AMOUNT, 1.0f, result.ShadowValue);
+		shadedColor = baseColor * GetLightAmount(config, result);
 		depth		= Math::Clamp01(Math::Remap(-10.0f, 40.0f, 0.0f, 1.0f, result.Position.z + result.Position.w));
 
 		// Depth Fog.		
@@ -166,7 +175,7 @@ private:
 			ResultColor surfaceColor	= GetColorForRayResult_Surfaces(config, result);
 			baseColor					= baseColor * 0.5f + surfaceColor * 0.5f;
 		}
-		const ResultColor shadedColor = baseColor * Math::Remap(0.0f, 1.0f, config.AMBIENT_LIGHT_AMOUNT, 1.0f, result.ShadowValue);
+		const ResultColor shadedColor = baseColor * GetLightAmount(config, result);
 		return shadedColor;
 	}
 
@@ -386,7 +395,7 @@ private:
 			ResultColor surfaceColor	= ResultColor{heatRed, 0, heatBlue, 255};
 			baseColor					= surfaceColor;
 		}
-		shadedColor = baseColor * Math::Remap(0.0f, 1.0f, config.AMBIENT_LIGHT_AMOUNT, 1.0f, result.ShadowValue);
+		shadedColor = baseColor * GetLightAmount(config, result);
 
 		return shadedColor;
 	}
@@ -0,0 +1,239 @@
+#pragma once
+
+#include <glm\ext\vector_float2.hpp>
+#include <glm\ext\vector_float4.hpp>
+#include <glm\geometric.hpp>
+
+#include "MathLib/Types/Ray.h"
+#include "MathLib/Types/Hyperplane.h"
+#include "MathLib/Types/Hypersphere.h"
+#include "MathLib/Types/ConvexPolytope.h"
+
+#include "MathLib/Functions/Core.h"
+#include "MathLib/Constants.h"
+
+#include "Rendering/CUDATypes.h"
+
+namespace Math
+{
+	//////////////////////////////////////////////////////////////////////////
+	// Biray Intersections
+	// A biray spans the plane origin + main * DirectionMain + secondary * DirectionSecondary. Like the march, we only search the quadrant
+	// with main and secondary in [0, maxDistance]. The first hit is the point of the solid in that quadrant with the smallest main parameter,
+	// which is where the march would end up after its edge walk. Ties go to the smaller secondary parameter.
+	//////////////////////////////////////////////////////////////////////////
+
+	struct BiRayHit
+	{
+		float TraversedMain			= 0.0f;
+		float TraversedSecondary	= 0.0f;
+		glm::vec4 Position			= glm::vec4(0.0f);
+		glm::vec4 Normal			= glm::vec4(0.0f);
+	};
+
+	//////////////////////////////////////////////////////////////////////////
+
+	namespace BiRayIntersection
+	{
+		// The searched quadrant, clipped by every half-space, has at most one corner more per half-space.
+		static constexpr int MAX_POLYGON_VERTICES	= 4 + ConvexPolytope::MAX_HALFSPACES;
+		static constexpr float FACE_PROBE_DISTANCE	= 0.001f;	// < Along the main direction, in front of a hit.
+
+		// Clips a convex polygon in biray parameters against a.x * main + a.y * secondary <= b. Returns the new vertex count.
+		A_CUDA_CPUGPU inline int ClipPolygon(const glm::vec2* polygon, const int vertexCount, const glm::vec2& a, const float b, glm::vec2* outPolygon)
+		{
+			int outVertexCount = 0;
+			for (int i = 0; i < vertexCount; i++)
+			{
+				const glm::vec2& current	= polygon[i];
+				const glm::vec2& next		= polygon[(i + 1) % vertexCount];
+				const float currentDistance	= glm::dot(a, current) - b;
+				const float nextDistance	= glm::dot(a, next) - b;
+
+				if (currentDistance <= 0.0f)
+				{
+					outPolygon[outVertexCount++] = current;
+				}
+				if ((currentDistance <= 0.0f) != (nextDistance <= 0.0f))
+				{
+					outPolygon[outVertexCount++] = current + (next - current) * (currentDistance / (currentDistance - nextDistance));
+				}
+			}
+			return outVertexCount;
+		}
+
+		//////////////////////////////////////////////////////////////////////////
+
+		// Solves |x * direction - toCenter| = radius. Returns false if the line misses the hypersphere.
+		A_CUDA_CPUGPU inline bool IntersectLine(const glm::vec4& direction, const glm::vec4& toCenter, const float radius, float& outNear, float& outFar)
+		{
+			const float a				= glm::dot(direction, direction);
+			const float halfB			= glm::dot(direction, toCenter);
+			const float c				= glm::dot(toCenter, toCenter) - radius * radius;
+			const float discriminant	= halfB * halfB - a * c;
+			if (a < Epsilon || discriminant < 0.0f)
+			{
+				return false;
+			}
+
+			const float root	= sqrtf(discriminant);
+			outNear				= (halfB - root) / a;
+			outFar				= (halfB + root) / a;
+			return true;
+		}
+
+		//////////////////////////////////////////////////////////////////////////
+
+		// Every half-space cuts the plane of the biray in a half-plane. Their intersection with the searched quadrant is a convex polygon,
+		// and the first hit is one of its corners.
+		A_CUDA_CPUGPU inline bool IntersectHalfSpaces(const BiRay<glm::vec4>& biRay, const Hyperplane* halfSpaces, const int halfSpaceCount, const float maxDistance, BiRayHit* outHit)
+		{
+			glm::vec2 polygons[2][MAX_POLYGON_VERTICES];
+			polygons[0][0]	= glm::vec2(0.0f, 0.0f);
+			polygons[0][1]	= glm::vec2(maxDistance, 0.0f);
+			polygons[0][2]	= glm::vec2(maxDistance, maxDistance);
+			polygons[0][3]	= glm::vec2(0.0f, maxDistance);
+			int vertexCount	= 4;
+			int current		= 0;
+
+			for (int i = 0; i < halfSpaceCount; i++)
+			{
+				const Hyperplane& halfSpace	= halfSpaces[i];
+				const glm::vec2 a			= glm::vec2(glm::dot(halfSpace.Normal, biRay.DirectionMain), glm::dot(halfSpace.Normal, biRay.DirectionSecondary));
+				const float b				= -halfSpace.EvaluateDistance(biRay.Origin);
+
+				vertexCount	= ClipPolygon(polygons[current], vertexCount, a, b, polygons[1 - current]);
+				current		= 1 - current;
+				if (vertexCount == 0)
+				{
+					return false;
+				}
+			}
+
+			glm::vec2 first = polygons[current][0];
+			for (int i = 1; i < vertexCount; i++)
+			{
+				const glm::vec2& vertex = polygons[current][i];
+				if (vertex.x < first.x - Epsilon || (vertex.x < first.x + Epsilon && vertex.y < first.y))
+				{
+					first = vertex;
+				}
+			}
+
+			if (outHit)
+			{
+				outHit->TraversedMain		= first.x;
+				outHit->TraversedSecondary	= first.y;
+				outHit->Position			= biRay.At(first.x, first.y);
+
+				// The corner can lie on several faces. Take the one the biray enters through, i.e. the one that is closest slightly before the hit.
+				const glm::vec4 probe	= outHit->Position - biRay.DirectionMain * FACE_PROBE_DISTANCE;
+				int entryFace			= 0;
+				float entryDistance		= halfSpaces[0].EvaluateDistance(probe);
+				for (int i = 1; i < halfSpaceCount; i++)
+				{
+					const float distance = halfSpaces[i].EvaluateDistance(probe);
+					if (distance > entryDistance)
+					{
+						entryFace		= i;
+						entryDistance	= distance;
+					}
+				}
+				outHit->Normal = halfSpaces[entryFace].Normal;
+			}
+
+			return true;
+		}
+	}
+
+	//////////////////////////////////////////////////////////////////////////
+
+	A_CUDA_CPUGPU inline bool Intersects(const BiRay<glm::vec4>& biRay, const Hyperplane& hyperplane, const float maxDistance, BiRayHit* outHit = nullptr)
+	{
+		return BiRayIntersection::IntersectHalfSpaces(biRay, &hyperplane, 1, maxDistance, outHit);
+	}
+
+	//////////////////////////////////////////////////////////////////////////
+
+	A_CUDA_CPUGPU inline bool Intersects(const BiRay<glm::vec4>& biRay, const ConvexPolytope& polytope, const float maxDistance, BiRayHit* outHit = nullptr)
+	{
+		if (polytope.HalfSpaceCount == 0)
+		{
+			return false;
+		}
+
+		return BiRayIntersection::IntersectHalfSpaces(biRay, polytope.HalfSpaces, polytope.HalfSpaceCount, maxDistance, outHit);
+	}
+
+	//////////////////////////////////////////////////////////////////////////
+
+	A_CUDA_CPUGPU inline bool Intersects(const BiRay<glm::vec4>& biRay, const Hypershere& hypersphere, const float maxDistance, BiRayHit* outHit = nullptr)
+	{
+		// The plane of the biray cuts the hypersphere in a disk. We find the disk in an orthonormal frame (u, v) of the plane,
+		// in which the main parameter is linear, so its smallest value on the disk lies opposite to its gradient.
+		const glm::vec4 toCenter				= hypersphere.Origin - biRay.Origin;
+		const float lengthMain					= glm::length(biRay.DirectionMain);
+		const glm::vec4 axisU					= biRay.DirectionMain / lengthMain;
+		const float secondaryAlongU				= glm::dot(biRay.DirectionSecondary, axisU);
+		const glm::vec4 secondaryOrthogonal		= biRay.DirectionSecondary - secondaryAlongU * axisU;
+		const float lengthSecondaryOrthogonal	= glm::length(secondaryOrthogonal);
+		if (lengthMain < Epsilon || lengthSecondaryOrthogonal < Epsilon)
+		{
+			// Degenerated biray
+			return false;
+		}
+
+		const glm::vec4 axisV			= secondaryOrthogonal / lengthSecondaryOrthogonal;
+		const glm::vec2 diskCenter		= glm::vec2(glm::dot(toCenter, axisU), glm::dot(toCenter, axisV));
+		const float diskRadiusSquared	= hypersphere.Radius * hypersphere.Radius - (glm::dot(toCenter, toCenter) - glm::dot(diskCenter, diskCenter));
+		if (diskRadiusSquared < 0.0f)
+		{
+			return false;
+		}
+
+		// secondary = v / lengthSecondaryOrthogonal, main = (u - secondary * secondaryAlongU) / lengthMain
+		const glm::vec2 mainGradient	= glm::vec2(1.0f, -secondaryAlongU / lengthSecondaryOrthogonal) / lengthMain;
+		const glm::vec2 diskFirst		= diskCenter - glm::normalize(mainGradient) * sqrtf(diskRadiusSquared);
+		float secondary					= diskFirst.y / lengthSecondaryOrthogonal;
+		float main						= (diskFirst.x - secondary * secondaryAlongU) / lengthMain;
+
+		// Outside of the quadrant, the first hit moves onto its border. The disk is convex, so if it reaches into the quadrant at all, it crosses that border.
+		float near;
+		float far;
+		if (secondary < 0.0f)
+		{
+			if (!BiRayIntersection::IntersectLine(biRay.DirectionMain, toCenter, hypersphere.Radius, near, far))
+			{
+				return false;
+			}
+			main		= near;
+			secondary	= 0.0f;
+		}
+		if (main < 0.0f)
+		{
+			// The biray starts inside of the hypersphere.
+			if (!BiRayIntersection::IntersectLine(biRay.DirectionSecondary, toCenter, hypersphere.Radius, near, far) || far < 0.0f)
+			{
+				return false;
+			}
+			main		= 0.0f;
+			secondary	= Math::Max(near, 0.0f);
+		}
+		if (main > maxDistance || secondary > maxDistance)
+		{
+			return false;
+		}
+
+		if (outHit)
+		{
+			outHit->TraversedMain		= main;
+			outHit->TraversedSecondary	= secondary;
+			outHit->Position			= biRay.At(main, secondary);
+			outHit->Normal				= glm::normalize(outHit->Position - hypersphere.Origin);
+		}
+
+		return true;
+	}
+
+	//////////////////////////////////////////////////////////////////////////
+}
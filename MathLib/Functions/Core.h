@@ -308,6 +308,20 @@ namespace Math
 
 	//////////////////////////////////////////////////////////////////////////
 
+	A_CUDA_CPUGPU inline float MinComponent(const glm::vec3& vec)
+	{
+		return glm::min(glm::min(vec.x, vec.y), vec.z);
+	}
+
+	//////////////////////////////////////////////////////////////////////////
+
+	A_CUDA_CPUGPU inline float MinComponent(const glm::vec4& vec)
+	{
+		return glm::min(glm::min(glm::min(vec.x, vec.y), vec.z), vec.w);
+	}
+
+	//////////////////////////////////////////////////////////////////////////
+
 	//////////////////////////////////////////////////////////////////////////
 	// LERP
 	//////////////////////////////////////////////////////////////////////////
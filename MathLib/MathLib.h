@@ -20,6 +20,8 @@ namespace Math
 #include "MathLib\Types\Tetrahedron.h"
 #include "MathLib\Types\Sphere.h"
 #include "MathLib\Types\Hypersphere.h"
+#include "MathLib\Types\Hyperplane.h"
+#include "MathLib\Types\ConvexPolytope.h"
 
 // Custom Functions
 
@@ -30,6 +32,7 @@ namespace Math
 
 #include "MathLib\Functions\Collision2.h"
 #include "MathLib\Functions\Collision3.h"
+#include "MathLib\Functions\Collision4.h"
 
 #include "MathLib\Functions\Noise.h"
 
@@ -39,5 +42,8 @@ namespace Math
 #include "MathLib\SignedDistanceFields\SignedDistanceFieldAlterations.h"
 #include "MathLib\SignedDistanceFields\SignedDistanceFieldBooleans.h"
 #include "MathLib\SignedDistanceFields\SignedDistanceFieldPrimitives.h"
+#include "MathLib\SignedDistanceFields\SignedDistanceFieldProgram.h"
+#include "MathLib\SignedDistanceFields\SignedDistanceFieldHierarchy.h"
+#include "MathLib\SignedDistanceFields\SignedDistanceFieldInstances.h"
 #include "MathLib\SignedDistanceFields\SignedDistanceFieldTransformations.h"
 #include "MathLib\SignedDistanceFields\SignedDistanceFieldTypes.h"
\ No newline at end of file
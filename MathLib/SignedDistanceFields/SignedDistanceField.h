@@ -78,22 +78,33 @@ namespace Math
 
 	//////////////////////////////////////////////////////////////////////////
 
+	// Distance of the taps of EvaluateToSurfaceVector(ZW) in 4D.
+	static constexpr float SURFACE_VECTOR_STENCIL_SIZE = 0.005f;
+
+	// Same as EvaluateToSurfaceVectorZW, for positions whose distance is already known. Only the taps are evaluated.
 	template <class SDF, class N>
-	A_CUDA_CPUGPU static N EvaluateToSurfaceVectorZW(const SDF& sdf, const N& position, float& outDistance)
+	A_CUDA_CPUGPU static N EvaluateToSurfaceVectorZWFromDistance(const SDF& sdf, const N& position, const float distance)
 	{
 		// We use a triangle technique to assure that x & y are 0, because otherwise, they can cause issues in our birayToWorldSpace transformations.
 		
-		constexpr float H	= 0.005f;
+		constexpr float H	= SURFACE_VECTOR_STENCIL_SIZE;
 			
 		const glm::vec4 a = glm::vec4(0.0f, 0.0f, 1.0f, 0.0f);
 		const glm::vec4 b = glm::vec4(0.0f, 0.0f, -0.479f, 0.86f);
 		const glm::vec4 c = glm::vec4(0.0f, 0.0f, -0.479f, -0.86f);
-			
-		outDistance	= sdf.EvaluateDistance(position);
 
-		return -glm::normalize(	a * (sdf.EvaluateDistance(position + a * H) - outDistance) + 
-								b * (sdf.EvaluateDistance(position + b * H) - outDistance) + 
-								c * (sdf.EvaluateDistance(position + c * H) - outDistance));
+		return -glm::normalize(	a * (sdf.EvaluateDistance(position + a * H) - distance) + 
+								b * (sdf.EvaluateDistance(position + b * H) - distance) + 
+								c * (sdf.EvaluateDistance(position + c * H) - distance));
+	}
+
+	//////////////////////////////////////////////////////////////////////////
+
+	template <class SDF, class N>
+	A_CUDA_CPUGPU static N EvaluateToSurfaceVectorZW(const SDF& sdf, const N& position, float& outDistance)
+	{
+		outDistance	= sdf.EvaluateDistance(position);
+		return EvaluateToSurfaceVectorZWFromDistance(sdf, position, outDistance);
 	}
 
 	//////////////////////////////////////////////////////////////////////////
@@ -120,7 +131,7 @@ namespace Math
 		}
 		else if constexpr (std::is_same<N, glm::vec4>::value)
 		{
-			constexpr float H	= 0.005f;
+			constexpr float H	= SURFACE_VECTOR_STENCIL_SIZE;
 			
 			const glm::vec4 a = glm::vec4(0.250000f, 0.322749f, 0.456435f, -0.790569f);
 			const glm::vec4 b = glm::vec4(0.250000f, 0.322749f, 0.456435f, 0.790569f);
@@ -3,6 +3,7 @@
 #include <cuda_runtime_api.h>
 
 #include <memory>
+#include <type_traits>
 
 #include "MathLib/SignedDistanceFields/SignedDistanceField.h"
 #include "MathLib/SignedDistanceFields/SignedDistanceFieldTypes.h"
@@ -95,4 +96,87 @@ namespace Math
 		VectorType	m_Span;
 
 	};
+	
+	//////////////////////////////////////////////////////////////////////////
+	// SDF Bounded
+	// Only evaluates the child close to a cheap bounding volume that fully contains it. Farther away the distance to the bound
+	// is returned instead, which is a valid lower bound of the child's distance, so marching stays conservative.
+	// Meant for costly subtrees, like smooth booleans and repetitions.
+	// T may be a reference to bound a field that is owned elsewhere, like an acceleration structure.
+	//////////////////////////////////////////////////////////////////////////
+
+	enum class SDFBoundShape : unsigned char
+	{
+		Hypersphere,
+		Box
+	};
+
+	template <typename T>
+	class SDFBounded : public SignedDistanceField
+	{
+	public:
+		using VectorType = typename std::remove_reference_t<T>::VectorType;
+		using ResultType = SDFEvaluateResult<VectorType>;
+		
+		SDFBounded() = delete;
+
+		// The margin is the distance to the bound below which the child is evaluated.
+		A_CUDA_CPUGPU explicit SDFBounded(T&& sdf, const VectorType& center, const float radius, const float margin) :
+			m_SDF(std::forward<T>(sdf)), m_Center(center), m_Extents(radius), m_Margin(margin), m_Shape(SDFBoundShape::Hypersphere) {}
+
+		A_CUDA_CPUGPU explicit SDFBounded(T&& sdf, const VectorType& center, const VectorType& extents, const float margin) :
+			m_SDF(std::forward<T>(sdf)), m_Center(center), m_Extents(extents), m_Margin(margin), m_Shape(SDFBoundShape::Box) {}
+
+		A_CUDA_CPUGPU T& GetSDF() { return m_SDF; }
+
+		// Has to follow the child whenever it changes.
+		void SetBound(const VectorType& center, const float radius)
+		{
+			m_Center	= center;
+			m_Extents	= VectorType(radius);
+			m_Shape		= SDFBoundShape::Hypersphere;
+		}
+
+		//////////////////////////////////////////////////////////////////////////
+
+		A_CUDA_CPUGPU inline float EvaluateDistance(const VectorType& position) const
+		{
+			const float boundDistance = EvaluateBoundDistance(position);
+			if (boundDistance > m_Margin)
+			{
+				return boundDistance;
+			}
+
+			return m_SDF.EvaluateDistance(position);
+		}
+
+		//////////////////////////////////////////////////////////////////////////
+		
+		A_CUDA_CPUGPU inline VectorType GetLocalSamplePosition(const VectorType& position) const
+		{
+			return m_SDF.GetLocalSamplePosition(position);
+		}
+
+		//////////////////////////////////////////////////////////////////////////
+
+		// 0 inside the bound.
+		A_CUDA_CPUGPU inline float EvaluateBoundDistance(const VectorType& position) const
+		{
+			if (m_Shape == SDFBoundShape::Hypersphere)
+			{
+				return Math::Max(Math::Length(position - m_Center) - m_Extents.x, 0.0f);
+			}
+
+			const VectorType q = Math::Abs(position - m_Center) - m_Extents;
+			return Math::Length(Math::Max(q, VectorType(0.0f)));
+		}
+
+	private:
+		T				m_SDF;
+		VectorType		m_Center;
+		VectorType		m_Extents;	// < Radius (x) of a hypersphere bound.
+		float			m_Margin;
+		SDFBoundShape	m_Shape;
+
+	};
 }
\ No newline at end of file
@@ -115,7 +115,7 @@ namespace Math
 			const float distanceRHS	= m_RHS.EvaluateDistance(position);
 
 			const float h = Math::Clamp01(0.5f + 0.5f * (distanceRHS - distanceLHS) / m_Smoothness);
-			return Math::UnclampedLerp(localPositionLHS, localPositionRHS, h) - m_Smoothness * h * (1.0f - h);
+			return Math::UnclampedLerp(localPositionRHS, localPositionLHS, h) - m_Smoothness * h * (1.0f - h);
 		}
 
 		//////////////////////////////////////////////////////////////////////////
@@ -237,7 +237,7 @@ namespace Math
 			const float distanceRHS	= m_RHS.EvaluateDistance(position);
 			
 			const float h = Math::Clamp01(0.5f - 0.5f * (distanceRHS - distanceLHS) / m_Smoothness);
-			return Math::UnclampedLerp(localPositionLHS, localPositionRHS, h) + m_Smoothness * h * (1.0f - h);
+			return Math::UnclampedLerp(localPositionRHS, localPositionLHS, h) + m_Smoothness * h * (1.0f - h);
 		}
 
 		//////////////////////////////////////////////////////////////////////////
@@ -328,6 +328,7 @@ namespace Math
 
 	//////////////////////////////////////////////////////////////////////////
 
+	// Substracts lhs from rhs, like SDFSubstraction
 	template <class T, class U>
 	class SDFSmoothSubstraction : public SignedDistanceField
 	{
@@ -344,8 +345,8 @@ namespace Math
 
 		A_CUDA_CPUGPU inline float EvaluateDistance(const VectorType& position) const
 		{
-			const float distanceRHS = m_LHS.EvaluateDistance(position);
-			const float distanceLHS	= m_RHS.EvaluateDistance(position);
+			const float distanceLHS	= m_LHS.EvaluateDistance(position);
+			const float distanceRHS = m_RHS.EvaluateDistance(position);
 
 			const float h = Math::Clamp01(0.5f - 0.5f * (distanceRHS + distanceLHS) / m_Smoothness);
 			return Math::UnclampedLerp(distanceRHS, -distanceLHS, h) + m_Smoothness * h * (1.0f - h);
@@ -362,7 +363,7 @@ namespace Math
 			const float distanceRHS	= m_RHS.EvaluateDistance(position);
 			
 			const float h = Math::Clamp01(0.5f - 0.5f * (distanceRHS + distanceLHS) / m_Smoothness);
-			return Math::UnclampedLerp(localPositionLHS, -localPositionRHS, h) + m_Smoothness * h * (1.0f - h);
+			return Math::UnclampedLerp(localPositionRHS, -localPositionLHS, h) + m_Smoothness * h * (1.0f - h);
 		}	
 
 		//////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,474 @@
+#pragma once
+
+#include <cuda_runtime_api.h>
+
+#include <algorithm>
+#include <cfloat>
+#include <thread>
+#include <vector>
+
+#include "MathLib/SignedDistanceFields/SignedDistanceField.h"
+#include "MathLib/SignedDistanceFields/SignedDistanceFieldProgram.h"
+#include "MathLib/Types/Hypersphere.h"
+#include "MathLib/Functions/Core.h"
+
+#include "Rendering/CUDATypes.h"
+
+namespace Math
+{
+	//////////////////////////////////////////////////////////////////////////
+	// SDF Hierarchy
+	// Union of many primitives with a bounding volume hierarchy of hyperspheres over them.
+	// SDFUnion always evaluates both children, so a union of N objects costs N evaluations per sample. The hierarchy only
+	// visits nodes whose bound is closer than the best distance found so far, which is roughly O(log N) for spread out objects.
+	//////////////////////////////////////////////////////////////////////////
+
+	// Primitives that can be stored by value in leaves and instance prototypes. Parameter holds the extents of a box, or the radius (x) of a hypersphere.
+	A_CUDA_CPUGPU inline float EvaluatePrimitiveDistance(const SDFOpCode primitive, const glm::vec4& parameter, const glm::vec4& localPosition)
+	{
+		if (primitive == SDFOpCode::HyperSphere)
+		{
+			return Math::Length(localPosition) - parameter.x;
+		}
+
+		const glm::vec4 q = Math::Abs(localPosition) - parameter;
+		return Math::Min(Math::MaxComponent(q), 0.0f) + Math::Length(Math::Max(q, glm::vec4(0.0f)));
+	}
+
+	A_CUDA_CPUGPU inline float GetPrimitiveBoundsRadius(const SDFOpCode primitive, const glm::vec4& parameter)
+	{
+		return (primitive == SDFOpCode::HyperSphere) ? parameter.x : Math::Length(parameter);
+	}
+
+	//////////////////////////////////////////////////////////////////////////
+
+	struct SDFHierarchyLeaf
+	{
+		glm::mat4	Transformation	= glm::mat4(1.0f);	// < Needs to be rigid, so that distances are preserved.
+		glm::vec4	Offset			= glm::vec4(0.0f);
+		glm::vec4	Parameter		= glm::vec4(0.0f);	// < Extents of a box, radius (x) of a hypersphere.
+		SDFOpCode	Primitive		= SDFOpCode::Box;
+		int			MaterialID		= 0;
+
+		//////////////////////////////////////////////////////////////////////////
+
+		// Same as SDFAffine::SetTranslationAndTransformation.
+		A_CUDA_CPUGPU inline void SetTranslationAndTransformation(const glm::vec4& translation, const glm::mat4& transformation)
+		{
+			Transformation	= transformation;
+			Offset			= -(transformation * translation);
+		}
+
+		A_CUDA_CPUGPU inline glm::vec4 GetLocalSamplePosition(const glm::vec4& position) const
+		{
+			return Transformation * position + Offset;
+		}
+
+		A_CUDA_CPUGPU inline float EvaluateDistance(const glm::vec4& position) const
+		{
+			return EvaluatePrimitiveDistance(Primitive, Parameter, GetLocalSamplePosition(position));
+		}
+
+		// Rigid transformations do not change the size, so the bound is the primitive's bound around its world space origin.
+		A_CUDA_CPUGPU inline glm::vec4 GetBoundsCenter() const
+		{
+			return -(glm::transpose(Transformation) * Offset);
+		}
+
+		A_CUDA_CPUGPU inline float GetBoundsRadius() const
+		{
+			return GetPrimitiveBoundsRadius(Primitive, Parameter);
+		}
+	};
+
+	//////////////////////////////////////////////////////////////////////////
+
+	struct SDFHierarchyNode
+	{
+		glm::vec4	Center		= glm::vec4(0.0f);
+		float		Radius		= 0.0f;
+		int			RightChild	= 0;	// < Internal nodes only. The left child directly follows its parent.
+		int			FirstLeaf	= 0;	// < Leaf nodes only.
+		int			LeafCount	= 0;	// < 0 for internal nodes.
+	};
+
+	//////////////////////////////////////////////////////////////////////////
+
+	class SDFHierarchy : public SignedDistanceField
+	{
+	public:
+		using VectorType = glm::vec4;
+
+		static constexpr int MAX_LEAVES_PER_NODE	= 4;
+		static constexpr int MAX_DEPTH				= 32;
+
+		// Refit splits the leaf nodes over worker threads above this many leaves.
+		static constexpr int PARALLEL_REFIT_LEAF_COUNT	= 4096;
+		// Refit rebuilds the tree once the summed node radii grew by this factor since the last build.
+		static constexpr float REBUILD_COST_RATIO		= 1.5f;
+
+		SDFHierarchy() = default;
+		~SDFHierarchy() { Release(); }
+
+		SDFHierarchy(const SDFHierarchy&) = delete;
+		SDFHierarchy& operator=(const SDFHierarchy&) = delete;
+
+		//////////////////////////////////////////////////////////////////////////
+
+		A_CUDA_CPUGPU inline float EvaluateDistance(const VectorType& position) const
+		{
+			int bestLeaf;
+			return Traverse(position, bestLeaf);
+		}
+
+		//////////////////////////////////////////////////////////////////////////
+
+		A_CUDA_CPUGPU inline VectorType GetLocalSamplePosition(const VectorType& position) const
+		{
+			int bestLeaf;
+			Traverse(position, bestLeaf);
+			return (bestLeaf >= 0) ? mcm_Leaves[bestLeaf].GetLocalSamplePosition(position) : position;
+		}
+
+		//////////////////////////////////////////////////////////////////////////
+
+		A_CUDA_CPUGPU inline int GetMaterialID(const VectorType& position) const
+		{
+			int bestLeaf;
+			Traverse(position, bestLeaf);
+			return (bestLeaf >= 0) ? mcm_Leaves[bestLeaf].MaterialID : 0;
+		}
+
+		//////////////////////////////////////////////////////////////////////////
+
+		A_CUDA_CPUGPU inline int GetLeafCount() const
+		{
+			return m_LeafCount;
+		}
+
+		// Leaves are reordered by a build, the id is the index the leaf had when it was passed to Build.
+		// Call Refit() after moving leaves.
+		A_CUDA_CPUGPU inline SDFHierarchyLeaf& GetLeaf(const int leafID)
+		{
+			return mcm_Leaves[mcm_LeafSlots[leafID]];
+		}
+
+		Hypershere GetBoundingHypersphere() const
+		{
+			return (m_NodeCount > 0) ? Hypershere(mcm_Nodes[0].Center, mcm_Nodes[0].Radius) : Hypershere();
+		}
+
+		//////////////////////////////////////////////////////////////////////////
+
+		// Builds the hierarchy top down, splitting at the median of the longest axis of the leaf centers.
+		// The leaves are copied and reordered internally, GetLeaf maps the original index to the reordered leaf.
+		void Build(const SDFHierarchyLeaf* leaves, const int leafCount)
+		{
+			Release();
+			if (leafCount <= 0)
+			{
+				return;
+			}
+
+			const int maxNodeCount = 2 * leafCount;
+			CUDA_CHECK_ERROR(cudaMallocManaged(reinterpret_cast<void**>(&mcm_Leaves), leafCount * sizeof(SDFHierarchyLeaf)));
+			CUDA_CHECK_ERROR(cudaMallocManaged(reinterpret_cast<void**>(&mcm_LeafSlots), leafCount * sizeof(int)));
+			CUDA_CHECK_ERROR(cudaMallocManaged(reinterpret_cast<void**>(&mcm_Nodes), maxNodeCount * sizeof(SDFHierarchyNode)));
+			cudaDeviceSynchronize();
+
+			std::vector<int> order(leafCount);
+			for (int i = 0; i < leafCount; i++)
+			{
+				order[i] = i;
+			}
+
+			m_LeafCount = leafCount;
+			m_NodeCount = 0;
+			BuildNode(leaves, order, 0, leafCount, 0);
+
+			for (int i = 0; i < leafCount; i++)
+			{
+				mcm_Leaves[i]				= leaves[order[i]];
+				mcm_LeafSlots[order[i]]		= i;
+			}
+
+			m_BuildCost = ComputeCost();
+		}
+
+		//////////////////////////////////////////////////////////////////////////
+
+		// Updates all bounds in place after leaves moved, keeping the tree topology.
+		// Moving leaves makes the topology worse over time, so the tree gets rebuilt once it is too loose. Returns true in that case.
+		bool Refit()
+		{
+			if (m_NodeCount == 0)
+			{
+				return false;
+			}
+
+			// 1) Leaf nodes, optionally split over worker threads.
+			const int workerCount = (m_LeafCount >= PARALLEL_REFIT_LEAF_COUNT) ? static_cast<int>(std::max(1u, std::thread::hardware_concurrency())) : 1;
+			if (workerCount == 1)
+			{
+				RefitLeafNodes(0, m_NodeCount);
+			}
+			else
+			{
+				std::vector<std::thread> workers;
+				const int nodesPerWorker = (m_NodeCount + workerCount - 1) / workerCount;
+				for (int first = 0; first < m_NodeCount; first += nodesPerWorker)
+				{
+					workers.emplace_back(&SDFHierarchy::RefitLeafNodes, this, first, std::min(first + nodesPerWorker, m_NodeCount));
+				}
+				for (std::thread& worker : workers)
+				{
+					worker.join();
+				}
+			}
+
+			// 2) Internal nodes bottom up. Children always have a higher index than their parent.
+			for (int i = m_NodeCount - 1; i >= 0; i--)
+			{
+				SDFHierarchyNode& node = mcm_Nodes[i];
+				if (node.LeafCount == 0)
+				{
+					MergeBounds(mcm_Nodes[i + 1], mcm_Nodes[node.RightChild], node);
+				}
+			}
+
+			// 3) Quality check
+			if (ComputeCost() > m_BuildCost * REBUILD_COST_RATIO)
+			{
+				Rebuild();
+				return true;
+			}
+
+			return false;
+		}
+
+		//////////////////////////////////////////////////////////////////////////
+
+		void Rebuild()
+		{
+			std::vector<SDFHierarchyLeaf> leaves(m_LeafCount);
+			for (int i = 0; i < m_LeafCount; i++)
+			{
+				leaves[i] = GetLeaf(i);
+			}
+
+			Build(leaves.data(), static_cast<int>(leaves.size()));
+		}
+
+		//////////////////////////////////////////////////////////////////////////
+
+		void Release()
+		{
+			if (mcm_Leaves != nullptr)
+			{
+				cudaDeviceSynchronize();
+				CUDA_CHECK_ERROR(cudaFree(mcm_Leaves));
+				CUDA_CHECK_ERROR(cudaFree(mcm_LeafSlots));
+				CUDA_CHECK_ERROR(cudaFree(mcm_Nodes));
+			}
+
+			mcm_Leaves		= nullptr;
+			mcm_LeafSlots	= nullptr;
+			mcm_Nodes		= nullptr;
+			m_LeafCount		= 0;
+			m_NodeCount		= 0;
+			m_BuildCost		= 0.0f;
+		}
+
+	private:
+
+		A_CUDA_CPUGPU float Traverse(const VectorType& position, int& outBestLeaf) const
+		{
+			float bestDistance	= FLT_MAX;
+			outBestLeaf			= -1;
+
+			if (m_NodeCount == 0)
+			{
+				return bestDistance;
+			}
+
+			int stack[MAX_DEPTH];
+			int stackSize = 0;
+			stack[stackSize++] = 0;
+
+			while (stackSize > 0)
+			{
+				const int nodeIndex				= stack[--stackSize];
+				const SDFHierarchyNode& node	= mcm_Nodes[nodeIndex];
+
+				// The best distance might have improved since the node was pushed.
+				if (Math::Length(position - node.Center) - node.Radius >= bestDistance)
+				{
+					continue;
+				}
+
+				if (node.LeafCount > 0)
+				{
+					for (int i = node.FirstLeaf; i < node.FirstLeaf + node.LeafCount; i++)
+					{
+						const float distance = mcm_Leaves[i].EvaluateDistance(position);
+						if (distance < bestDistance)
+						{
+							bestDistance	= distance;
+							outBestLeaf		= i;
+						}
+					}
+					continue;
+				}
+
+				// Visit the nearer child first, it is the more likely one to shrink the best distance.
+				const int left				= nodeIndex + 1;
+				const int right				= node.RightChild;
+				const float boundLeft		= Math::Length(position - mcm_Nodes[left].Center) - mcm_Nodes[left].Radius;
+				const float boundRight		= Math::Length(position - mcm_Nodes[right].Center) - mcm_Nodes[right].Radius;
+				const bool isLeftNearer		= boundLeft <= boundRight;
+
+				const int nearChild			= isLeftNearer ? left : right;
+				const int farChild			= isLeftNearer ? right : left;
+				const float nearBound		= isLeftNearer ? boundLeft : boundRight;
+				const float farBound		= isLeftNearer ? boundRight : boundLeft;
+
+				if (farBound < bestDistance)	{ stack[stackSize++] = farChild; }
+				if (nearBound < bestDistance)	{ stack[stackSize++] = nearChild; }
+			}
+
+			return bestDistance;
+		}
+
+		//////////////////////////////////////////////////////////////////////////
+
+		int BuildNode(const SDFHierarchyLeaf* leaves, std::vector<int>& order, const int first, const int count, const int depth)
+		{
+			const int nodeIndex		= m_NodeCount++;
+			SDFHierarchyNode node	= ComputeBounds([&](const int i) -> const SDFHierarchyLeaf& { return leaves[order[first + i]]; }, count);
+
+			// Every level pushes at most one node on the traversal stack, so the depth bounds the stack size.
+			if (count <= MAX_LEAVES_PER_NODE || depth + 2 >= MAX_DEPTH)
+			{
+				node.FirstLeaf			= first;
+				node.LeafCount			= count;
+				mcm_Nodes[nodeIndex]	= node;
+				return nodeIndex;
+			}
+
+			// Split along the longest axis of the leaf centers.
+			glm::vec4 minCenter = glm::vec4(FLT_MAX);
+			glm::vec4 maxCenter = glm::vec4(-FLT_MAX);
+			for (int i = first; i < first + count; i++)
+			{
+				const glm::vec4 center = leaves[order[i]].GetBoundsCenter();
+				minCenter = Math::Min(minCenter, center);
+				maxCenter = Math::Max(maxCenter, center);
+			}
+
+			const glm::vec4 size	= maxCenter - minCenter;
+			int axis				= 0;
+			for (int i = 1; i < 4; i++)
+			{
+				axis = (size[i] > size[axis]) ? i : axis;
+			}
+
+			const int half = count / 2;
+			std::nth_element(order.begin() + first, order.begin() + first + half, order.begin() + first + count, [&](const int lhs, const int rhs)
+			{
+				return leaves[lhs].GetBoundsCenter()[axis] < leaves[rhs].GetBoundsCenter()[axis];
+			});
+
+			BuildNode(leaves, order, first, half, depth + 1);
+			node.RightChild			= BuildNode(leaves, order, first + half, count - half, depth + 1);
+			mcm_Nodes[nodeIndex]	= node;
+			return nodeIndex;
+		}
+
+		//////////////////////////////////////////////////////////////////////////
+
+		template <class GetLeafFunction>
+		static SDFHierarchyNode ComputeBounds(const GetLeafFunction& getLeaf, const int count)
+		{
+			glm::vec4 minBounds = glm::vec4(FLT_MAX);
+			glm::vec4 maxBounds = glm::vec4(-FLT_MAX);
+			for (int i = 0; i < count; i++)
+			{
+				const SDFHierarchyLeaf& leaf = getLeaf(i);
+				minBounds = Math::Min(minBounds, leaf.GetBoundsCenter() - glm::vec4(leaf.GetBoundsRadius()));
+				maxBounds = Math::Max(maxBounds, leaf.GetBoundsCenter() + glm::vec4(leaf.GetBoundsRadius()));
+			}
+
+			SDFHierarchyNode node;
+			node.Center = 0.5f * (minBounds + maxBounds);
+			for (int i = 0; i < count; i++)
+			{
+				const SDFHierarchyLeaf& leaf = getLeaf(i);
+				node.Radius = Math::Max(node.Radius, Math::Length(leaf.GetBoundsCenter() - node.Center) + leaf.GetBoundsRadius());
+			}
+			return node;
+		}
+
+		//////////////////////////////////////////////////////////////////////////
+
+		void RefitLeafNodes(const int firstNode, const int endNode)
+		{
+			for (int i = firstNode; i < endNode; i++)
+			{
+				SDFHierarchyNode& node = mcm_Nodes[i];
+				if (node.LeafCount > 0)
+				{
+					const SDFHierarchyNode bounds = ComputeBounds([&](const int leaf) -> const SDFHierarchyLeaf& { return mcm_Leaves[node.FirstLeaf + leaf]; }, node.LeafCount);
+					node.Center = bounds.Center;
+					node.Radius = bounds.Radius;
+				}
+			}
+		}
+
+		//////////////////////////////////////////////////////////////////////////
+
+		// Smallest hypersphere around both child spheres.
+		static void MergeBounds(const SDFHierarchyNode& lhs, const SDFHierarchyNode& rhs, SDFHierarchyNode& outNode)
+		{
+			const float distance = Math::Length(rhs.Center - lhs.Center);
+			if (distance + rhs.Radius <= lhs.Radius)
+			{
+				outNode.Center = lhs.Center;
+				outNode.Radius = lhs.Radius;
+			}
+			else if (distance + lhs.Radius <= rhs.Radius)
+			{
+				outNode.Center = rhs.Center;
+				outNode.Radius = rhs.Radius;
+			}
+			else
+			{
+				outNode.Radius = 0.5f * (distance + lhs.Radius + rhs.Radius);
+				outNode.Center = lhs.Center + (rhs.Center - lhs.Center) * ((outNode.Radius - lhs.Radius) / distance);
+			}
+		}
+
+		//////////////////////////////////////////////////////////////////////////
+
+		// Summed node radii. A rough measure of how many nodes a traversal has to visit.
+		float ComputeCost() const
+		{
+			float cost = 0.0f;
+			for (int i = 0; i < m_NodeCount; i++)
+			{
+				cost += mcm_Nodes[i].Radius;
+			}
+			return cost;
+		}
+
+		//////////////////////////////////////////////////////////////////////////
+
+		SDFHierarchyLeaf*	mcm_Leaves		= nullptr;
+		int*				mcm_LeafSlots	= nullptr;	// < Leaf id -> index into mcm_Leaves
+		SDFHierarchyNode*	mcm_Nodes		= nullptr;
+		int					m_LeafCount		= 0;
+		int					m_NodeCount		= 0;
+		float				m_BuildCost		= 0.0f;	// < ComputeCost() right after the last build.
+	};
+
+	//////////////////////////////////////////////////////////////////////////
+}
@@ -0,0 +1,315 @@
+#pragma once
+
+#include <cuda_runtime_api.h>
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <vector>
+
+#include "MathLib/SignedDistanceFields/SignedDistanceField.h"
+#include "MathLib/SignedDistanceFields/SignedDistanceFieldProgram.h"
+#include "MathLib/SignedDistanceFields/SignedDistanceFieldHierarchy.h"
+#include "MathLib/Types/Hypersphere.h"
+#include "MathLib/Functions/Core.h"
+
+#include "Rendering/CUDATypes.h"
+
+namespace Math
+{
+	//////////////////////////////////////////////////////////////////////////
+	// SDF Instances
+	// Many rigidly transformed copies of a few prototype primitives, sorted into a 4D uniform grid.
+	// A sample only evaluates the instances overlapping its own cell. Every other instance is known to be farther away than the
+	// cell border (plus padding), so the result is clamped to that distance and stays a valid lower bound for marching.
+	// The cost per sample depends on the instances per cell, not on the total count.
+	//////////////////////////////////////////////////////////////////////////
+
+	struct SDFInstancePrototype
+	{
+		SDFOpCode	Primitive	= SDFOpCode::Box;
+		glm::vec4	Parameter	= glm::vec4(0.0f);	// < Extents of a box, radius (x) of a hypersphere.
+	};
+
+	//////////////////////////////////////////////////////////////////////////
+
+	struct SDFInstance
+	{
+		glm::mat4	Transformation	= glm::mat4(1.0f);	// < Needs to be rigid, so that distances are preserved.
+		glm::vec4	Offset			= glm::vec4(0.0f);
+		int			PrototypeID		= 0;
+		int			MaterialID		= 0;
+
+		//////////////////////////////////////////////////////////////////////////
+
+		A_CUDA_CPUGPU inline void SetTranslationAndTransformation(const glm::vec4& translation, const glm::mat4& transformation)
+		{
+			Transformation	= transformation;
+			Offset			= -(transformation * translation);
+		}
+
+		A_CUDA_CPUGPU inline glm::vec4 GetLocalSamplePosition(const glm::vec4& position) const
+		{
+			return Transformation * position + Offset;
+		}
+
+		A_CUDA_CPUGPU inline glm::vec4 GetBoundsCenter() const
+		{
+			return -(glm::transpose(Transformation) * Offset);
+		}
+	};
+
+	//////////////////////////////////////////////////////////////////////////
+
+	class SDFInstances : public SignedDistanceField
+	{
+	public:
+		using VectorType = glm::vec4;
+
+		static constexpr int MAX_CELL_COUNT				= 1 << 20;
+		// Average instances per cell the cell size is chosen for. Each instance overlaps up to 16 cells on top of that.
+		static constexpr float TARGET_INSTANCES_PER_CELL	= 2.0f;
+		// Instances are sorted into every cell they come closer to than this fraction of the cell size.
+		static constexpr float CELL_PADDING					= 0.25f;
+
+		SDFInstances() = default;
+		~SDFInstances() { Release(); }
+
+		SDFInstances(const SDFInstances&) = delete;
+		SDFInstances& operator=(const SDFInstances&) = delete;
+
+		//////////////////////////////////////////////////////////////////////////
+
+		A_CUDA_CPUGPU inline float EvaluateDistance(const VectorType& position) const
+		{
+			int bestInstance;
+			return Query(position, bestInstance);
+		}
+
+		//////////////////////////////////////////////////////////////////////////
+
+		A_CUDA_CPUGPU inline VectorType GetLocalSamplePosition(const VectorType& position) const
+		{
+			int bestInstance;
+			Query(position, bestInstance);
+			return (bestInstance >= 0) ? mcm_Instances[bestInstance].GetLocalSamplePosition(position) : position;
+		}
+
+		//////////////////////////////////////////////////////////////////////////
+
+		A_CUDA_CPUGPU inline int GetMaterialID(const VectorType& position) const
+		{
+			int bestInstance;
+			Query(position, bestInstance);
+			return (bestInstance >= 0) ? mcm_Instances[bestInstance].MaterialID : 0;
+		}
+
+		//////////////////////////////////////////////////////////////////////////
+
+		A_CUDA_CPUGPU inline int GetInstanceCount() const
+		{
+			return m_InstanceCount;
+		}
+
+		Hypershere GetBoundingHypersphere() const
+		{
+			return m_Bounds;
+		}
+
+		//////////////////////////////////////////////////////////////////////////
+
+		// Copies prototypes and instances and sorts the instances into the grid.
+		// The cell size follows the instance density, but never gets smaller than the largest instance, so that one instance overlaps at most 2 cells per axis.
+		void Build(const SDFInstancePrototype* prototypes, const int prototypeCount, const SDFInstance* instances, const int instanceCount)
+		{
+			Release();
+			if (prototypeCount <= 0 || instanceCount <= 0)
+			{
+				return;
+			}
+
+			// 1) Bounds of all instances
+			std::vector<float> radii(instanceCount);
+			glm::vec4 minBounds	= glm::vec4(FLT_MAX);
+			glm::vec4 maxBounds	= glm::vec4(-FLT_MAX);
+			float maxRadius		= 0.0f;
+			for (int i = 0; i < instanceCount; i++)
+			{
+				const SDFInstancePrototype& prototype = prototypes[instances[i].PrototypeID];
+				radii[i]	= GetPrimitiveBoundsRadius(prototype.Primitive, prototype.Parameter);
+				minBounds	= Math::Min(minBounds, instances[i].GetBoundsCenter() - glm::vec4(radii[i]));
+				maxBounds	= Math::Max(maxBounds, instances[i].GetBoundsCenter() + glm::vec4(radii[i]));
+				maxRadius	= Math::Max(maxRadius, radii[i]);
+			}
+
+			const glm::vec4 extents	= maxBounds - minBounds;
+			m_Bounds				= Hypershere(0.5f * (minBounds + maxBounds), 0.5f * glm::length(extents));
+
+			// 2) Grid layout
+			double volume = 1.0;
+			for (int axis = 0; axis < 4; axis++)
+			{
+				volume *= std::max(static_cast<double>(extents[axis]), 1.0);
+			}
+
+			m_CellSize = Math::Max(static_cast<float>(std::pow(volume * TARGET_INSTANCES_PER_CELL / instanceCount, 0.25)), 2.0f * maxRadius);
+			long long cellCount;
+			while (true)
+			{
+				m_Padding	= CELL_PADDING * m_CellSize;
+				cellCount	= 1;
+				for (int axis = 0; axis < 4; axis++)
+				{
+					m_Dimensions[axis]	= std::max(1, static_cast<int>(std::ceil((extents[axis] + 2.0f * m_Padding) / m_CellSize)));
+					cellCount			*= m_Dimensions[axis];
+				}
+
+				if (cellCount <= MAX_CELL_COUNT)
+				{
+					break;
+				}
+				m_CellSize *= 1.25f;
+			}
+
+			m_GridMin	= minBounds - glm::vec4(m_Padding);
+			m_CellCount	= static_cast<int>(cellCount);
+
+			// 3) Copy the shared data
+			m_PrototypeCount	= prototypeCount;
+			m_InstanceCount		= instanceCount;
+			CUDA_CHECK_ERROR(cudaMallocManaged(reinterpret_cast<void**>(&mcm_Prototypes), prototypeCount * sizeof(SDFInstancePrototype)));
+			CUDA_CHECK_ERROR(cudaMallocManaged(reinterpret_cast<void**>(&mcm_Instances), instanceCount * sizeof(SDFInstance)));
+			CUDA_CHECK_ERROR(cudaMallocManaged(reinterpret_cast<void**>(&mcm_CellStarts), (m_CellCount + 1) * sizeof(int)));
+			cudaDeviceSynchronize();
+
+			std::copy(prototypes, prototypes + prototypeCount, mcm_Prototypes);
+			std::copy(instances, instances + instanceCount, mcm_Instances);
+
+			// 4) Count the cell entries, turn the counts into offsets, then fill in the instances
+			std::fill(mcm_CellStarts, mcm_CellStarts + m_CellCount + 1, 0);
+			ForEachOverlappedCell(radii, [&](const int cell, const int) { mcm_CellStarts[cell + 1]++; });
+			for (int cell = 0; cell < m_CellCount; cell++)
+			{
+				mcm_CellStarts[cell + 1] += mcm_CellStarts[cell];
+			}
+
+			CUDA_CHECK_ERROR(cudaMallocManaged(reinterpret_cast<void**>(&mcm_CellInstances), std::max(1, mcm_CellStarts[m_CellCount]) * sizeof(int)));
+			cudaDeviceSynchronize();
+
+			std::vector<int> fill(mcm_CellStarts, mcm_CellStarts + m_CellCount);
+			ForEachOverlappedCell(radii, [&](const int cell, const int instance) { mcm_CellInstances[fill[cell]++] = instance; });
+		}
+
+		//////////////////////////////////////////////////////////////////////////
+
+		void Release()
+		{
+			if (mcm_Instances != nullptr)
+			{
+				cudaDeviceSynchronize();
+				CUDA_CHECK_ERROR(cudaFree(mcm_Prototypes));
+				CUDA_CHECK_ERROR(cudaFree(mcm_Instances));
+				CUDA_CHECK_ERROR(cudaFree(mcm_CellStarts));
+				CUDA_CHECK_ERROR(cudaFree(mcm_CellInstances));
+			}
+
+			mcm_Prototypes		= nullptr;
+			mcm_Instances		= nullptr;
+			mcm_CellStarts		= nullptr;
+			mcm_CellInstances	= nullptr;
+			m_PrototypeCount	= 0;
+			m_InstanceCount		= 0;
+			m_CellCount			= 0;
+			m_Bounds			= Hypershere();
+		}
+
+	private:
+		A_CUDA_CPUGPU inline float Query(const VectorType& position, int& outBestInstance) const
+		{
+			outBestInstance = -1;
+			if (m_InstanceCount == 0)
+			{
+				return FLT_MAX;
+			}
+
+			const glm::vec4 gridPosition	= (position - m_GridMin) / m_CellSize;
+			const glm::vec4 cellCoordinates	= glm::floor(gridPosition);
+
+			// Outside of the grid, every instance is at least the padding away from the grid border.
+			const glm::vec4 gridSize = glm::vec4(m_Dimensions[0], m_Dimensions[1], m_Dimensions[2], m_Dimensions[3]);
+			if (Math::MinComponent(cellCoordinates) < 0.0f || Math::MinComponent(gridSize - cellCoordinates) < 1.0f)
+			{
+				const glm::vec4 halfSize	= 0.5f * m_CellSize * gridSize;
+				const glm::vec4 q			= Math::Abs(position - m_GridMin - halfSize) - halfSize;
+				return Math::Length(Math::Max(q, glm::vec4(0.0f))) + m_Padding;
+			}
+
+			int cell = 0;
+			for (int axis = 0; axis < 4; axis++)
+			{
+				cell = cell * m_Dimensions[axis] + static_cast<int>(cellCoordinates[axis]);
+			}
+
+			// Instances missing from this cell are at least the padding away from its border.
+			const glm::vec4 cellPosition	= gridPosition - cellCoordinates;
+			float bestDistance				= Math::MinComponent(Math::Min(cellPosition, glm::vec4(1.0f) - cellPosition)) * m_CellSize + m_Padding;
+
+			for (int i = mcm_CellStarts[cell]; i < mcm_CellStarts[cell + 1]; i++)
+			{
+				const SDFInstance& instance				= mcm_Instances[mcm_CellInstances[i]];
+				const SDFInstancePrototype& prototype	= mcm_Prototypes[instance.PrototypeID];
+				const float distance					= EvaluatePrimitiveDistance(prototype.Primitive, prototype.Parameter, instance.GetLocalSamplePosition(position));
+				if (distance < bestDistance)
+				{
+					bestDistance	= distance;
+					outBestInstance	= mcm_CellInstances[i];
+				}
+			}
+
+			return bestDistance;
+		}
+
+		//////////////////////////////////////////////////////////////////////////
+
+		template <class CellFunction>
+		void ForEachOverlappedCell(const std::vector<float>& radii, const CellFunction& cellFunction) const
+		{
+			for (int instance = 0; instance < m_InstanceCount; instance++)
+			{
+				const glm::vec4 center	= mcm_Instances[instance].GetBoundsCenter();
+				const float reach		= radii[instance] + m_Padding;
+
+				int minCell[4], maxCell[4];
+				for (int axis = 0; axis < 4; axis++)
+				{
+					minCell[axis] = std::max(0,							static_cast<int>(std::floor((center[axis] - reach - m_GridMin[axis]) / m_CellSize)));
+					maxCell[axis] = std::min(m_Dimensions[axis] - 1,	static_cast<int>(std::floor((center[axis] + reach - m_GridMin[axis]) / m_CellSize)));
+				}
+
+				for (int x = minCell[0]; x <= maxCell[0]; x++)
+				for (int y = minCell[1]; y <= maxCell[1]; y++)
+				for (int z = minCell[2]; z <= maxCell[2]; z++)
+				for (int w = minCell[3]; w <= maxCell[3]; w++)
+				{
+					cellFunction(((x * m_Dimensions[1] + y) * m_Dimensions[2] + z) * m_Dimensions[3] + w, instance);
+				}
+			}
+		}
+
+		//////////////////////////////////////////////////////////////////////////
+
+		SDFInstancePrototype*	mcm_Prototypes		= nullptr;
+		SDFInstance*			mcm_Instances		= nullptr;
+		int*					mcm_CellStarts		= nullptr;	// < m_CellCount + 1 offsets into mcm_CellInstances
+		int*					mcm_CellInstances	= nullptr;
+
+		int						m_PrototypeCount	= 0;
+		int						m_InstanceCount		= 0;
+		int						m_CellCount			= 0;
+		int						m_Dimensions[4]		= {};
+		glm::vec4				m_GridMin			= glm::vec4(0.0f);
+		float					m_CellSize			= 1.0f;
+		float					m_Padding			= 0.0f;
+		Hypershere				m_Bounds;
+	};
+}
@@ -136,6 +136,13 @@ namespace Math
 			return position;
 		}
 
+		//////////////////////////////////////////////////////////////////////////
+
+		A_CUDA_CPUGPU inline const VectorType& GetExtents() const
+		{
+			return m_Extents;
+		}
+
 	private:
 		VectorType m_Extents;
 	};
@@ -0,0 +1,653 @@
+#pragma once
+
+#include <cuda_runtime_api.h>
+
+#include <assert.h>
+
+#include "MathLib/SignedDistanceFields/SignedDistanceField.h"
+#include "MathLib/Functions/Core.h"
+
+#include "Rendering/CUDATypes.h"
+
+namespace Math
+{
+	//////////////////////////////////////////////////////////////////////////
+	// SDF Program
+	// A runtime representation of an SDF tree. The tree is flattened into a contiguous stream of instructions that run on
+	// a small register machine, so scenes can be built and changed without recompiling their template types.
+	//
+	// Registers are allocated like a stack: position modifiers push a new position register that the following primitives
+	// read from, primitives push a distance register and booleans pop two distance registers and push the result.
+	// Only 4D scenes are supported for now.
+	//
+	// Every evaluation interprets the stream. Stencils (normals, to-surface vectors) decode each instruction once for all of their taps.
+	//////////////////////////////////////////////////////////////////////////
+
+	enum class SDFOpCode : unsigned char
+	{
+		// Primitives: Position register -> Distance register
+		Box						= 0,
+		HyperSphere				= 1,
+
+		// Position modifiers: Position register -> Position register
+		Translation				= 2,
+		Transformation4x4		= 3,
+		Repetition				= 4,
+		FiniteRepetition		= 5,
+
+		// Distance modifiers: Distance register(s) -> Distance register
+		Onion					= 6,
+		Union					= 7,
+		SmoothUnion				= 8,
+		Intersection			= 9,
+		SmoothIntersection		= 10,
+		Substraction			= 11,
+		SmoothSubstraction		= 12,
+	};
+
+	// Index of the first parameter of an instruction. Used to change parameters (e.g. a transformation) after the program was built.
+	using SDFParameterHandle = unsigned short;
+
+	struct SDFInstruction
+	{
+		SDFOpCode			OpCode		= SDFOpCode::Box;
+		unsigned char		Target		= 0;
+		unsigned char		SourceA		= 0;
+		unsigned char		SourceB		= 0;
+		SDFParameterHandle	Parameter	= 0;	// < Index into the parameter pool. Scalar parameters are stored in x.
+	};
+
+	//////////////////////////////////////////////////////////////////////////
+
+	class A_CPUGPU_ALIGN(16) SDFProgram : public CUDAManaged
+	{
+		friend class SDFProgramBuilder;
+
+	public:
+		using VectorType = glm::vec4;
+
+		static constexpr int MAX_INSTRUCTIONS			= 64;
+		static constexpr int MAX_PARAMETERS				= 128;
+		// Sized for the deepest tree the scenes record, the builder asserts on it. The registers are indexed at runtime,
+		// so on the GPU every one of them costs local memory per thread (a vec4 resp. a float per point).
+		static constexpr int MAX_POSITION_REGISTERS		= 4;
+		static constexpr int MAX_DISTANCE_REGISTERS		= 4;
+
+		// Number of points that EvaluateDistances pushes through the instruction stream at once.
+		static constexpr int BATCH_SIZE					= 8;
+
+		// Largest batch of the stencils, which also run on the GPU: 6 * (4 vec4 + 4 float) = 480 bytes of registers per thread.
+		static constexpr int MAX_STENCIL_BATCH_SIZE		= 6;
+
+		//////////////////////////////////////////////////////////////////////////
+
+		A_CUDA_CPUGPU inline float EvaluateDistance(const VectorType& position) const
+		{
+			float distance;
+			Execute<1, false>(&position, &distance, nullptr);
+			return distance;
+		}
+
+		//////////////////////////////////////////////////////////////////////////
+
+		A_CUDA_CPUGPU inline VectorType GetLocalSamplePosition(const VectorType& position) const
+		{
+			float distance;
+			VectorType localPosition;
+			Execute<1, true>(&position, &distance, &localPosition);
+			return localPosition;
+		}
+
+		//////////////////////////////////////////////////////////////////////////
+
+		// Evaluates many points while decoding each instruction only once per batch. Host only, as a batch of BATCH_SIZE holds too many registers for a GPU thread.
+		void EvaluateDistances(const VectorType* positions, float* outDistances, const int count) const
+		{
+			int first = 0;
+			for (; first + BATCH_SIZE <= count; first += BATCH_SIZE)
+			{
+				Execute<BATCH_SIZE, false>(&positions[first], &outDistances[first], nullptr);
+			}
+
+			// Pad the remaining points with the last one, the padded results are discarded.
+			if (first < count)
+			{
+				VectorType	remainingPositions[BATCH_SIZE];
+				float		remainingDistances[BATCH_SIZE];
+				for (int i = 0; i < BATCH_SIZE; i++)
+				{
+					remainingPositions[i] = positions[(first + i < count) ? first + i : count - 1];
+				}
+
+				Execute<BATCH_SIZE, false>(remainingPositions, remainingDistances, nullptr);
+
+				for (int i = first; i < count; i++)
+				{
+					outDistances[i] = remainingDistances[i - first];
+				}
+			}
+		}
+
+		//////////////////////////////////////////////////////////////////////////
+
+		// Same taps as Math::SampleNormal, evaluated as one batch.
+		A_CUDA_CPUGPU VectorType SampleNormal(const VectorType& position) const
+		{
+			constexpr float H = 0.015f;
+			const VectorType taps[5] = {
+				glm::vec4(0.250000f, 0.322749f, 0.456435f, -0.790569f),
+				glm::vec4(0.250000f, 0.322749f, 0.456435f, 0.790569f),
+				glm::vec4(0.250000f, 0.322749f, -0.912871f, 0.000000f),
+				glm::vec4(0.264135f, -0.964486f, 0.000000f, 0.000000f),
+				glm::vec4(-1.000000f, 0.000000f, 0.000000f, 0.000000f)
+			};
+
+			VectorType	positions[5];
+			float		distances[5];
+			for (int i = 0; i < 5; i++)
+			{
+				positions[i] = position + taps[i] * H;
+			}
+
+			ExecuteDistances<5>(positions, distances);
+
+			VectorType normal = VectorType(0.0f);
+			for (int i = 0; i < 5; i++)
+			{
+				normal += taps[i] * distances[i];
+			}
+			return glm::normalize(normal);
+		}
+
+		//////////////////////////////////////////////////////////////////////////
+
+		// Same taps as Math::EvaluateToSurfaceVector, evaluated as one batch together with the center.
+		A_CUDA_CPUGPU VectorType EvaluateToSurfaceVector(const VectorType& position, float& outDistance) const
+		{
+			constexpr float H = 0.005f;
+			const VectorType taps[5] = {
+				glm::vec4(0.250000f, 0.322749f, 0.456435f, -0.790569f),
+				glm::vec4(0.250000f, 0.322749f, 0.456435f, 0.790569f),
+				glm::vec4(0.250000f, 0.322749f, -0.912871f, 0.000000f),
+				glm::vec4(0.264135f, -0.964486f, 0.000000f, 0.000000f),
+				glm::vec4(-1.000000f, 0.000000f, 0.000000f, 0.000000f)
+			};
+
+			VectorType	positions[6];
+			float		distances[6];
+			positions[0] = position;
+			for (int i = 0; i < 5; i++)
+			{
+				positions[i + 1] = position + taps[i] * H;
+			}
+
+			ExecuteDistances<6>(positions, distances);
+
+			outDistance = distances[0];
+
+			VectorType gradient = VectorType(0.0f);
+			for (int i = 0; i < 5; i++)
+			{
+				gradient += taps[i] * (distances[i + 1] - outDistance);
+			}
+			return -glm::normalize(gradient);
+		}
+
+		//////////////////////////////////////////////////////////////////////////
+
+		// Same taps as Math::EvaluateToSurfaceVectorZW, evaluated as one batch together with the center.
+		A_CUDA_CPUGPU VectorType EvaluateToSurfaceVectorZW(const VectorType& position, float& outDistance) const
+		{
+			constexpr float H = 0.005f;
+			const VectorType taps[3] = {
+				glm::vec4(0.0f, 0.0f, 1.0f, 0.0f),
+				glm::vec4(0.0f, 0.0f, -0.479f, 0.86f),
+				glm::vec4(0.0f, 0.0f, -0.479f, -0.86f)
+			};
+
+			VectorType	positions[4];
+			float		distances[4];
+			positions[0] = position;
+			for (int i = 0; i < 3; i++)
+			{
+				positions[i + 1] = position + taps[i] * H;
+			}
+
+			ExecuteDistances<4>(positions, distances);
+
+			outDistance = distances[0];
+
+			VectorType gradient = VectorType(0.0f);
+			for (int i = 0; i < 3; i++)
+			{
+				gradient += taps[i] * (distances[i + 1] - outDistance);
+			}
+			return -glm::normalize(gradient);
+		}
+
+		//////////////////////////////////////////////////////////////////////////
+
+		// Same taps as Math::EvaluateToSurfaceVectorZWFromDistance, the center distance is already known.
+		A_CUDA_CPUGPU VectorType EvaluateToSurfaceVectorZWFromDistance(const VectorType& position, const float distance) const
+		{
+			constexpr float H = 0.005f;
+			const VectorType taps[3] = {
+				glm::vec4(0.0f, 0.0f, 1.0f, 0.0f),
+				glm::vec4(0.0f, 0.0f, -0.479f, 0.86f),
+				glm::vec4(0.0f, 0.0f, -0.479f, -0.86f)
+			};
+
+			VectorType	positions[3];
+			float		distances[3];
+			for (int i = 0; i < 3; i++)
+			{
+				positions[i] = position + taps[i] * H;
+			}
+
+			ExecuteDistances<3>(positions, distances);
+
+			VectorType gradient = VectorType(0.0f);
+			for (int i = 0; i < 3; i++)
+			{
+				gradient += taps[i] * (distances[i] - distance);
+			}
+			return -glm::normalize(gradient);
+		}
+
+		//////////////////////////////////////////////////////////////////////////
+
+		A_CUDA_CPUGPU inline void SetParameter(const SDFParameterHandle handle, const VectorType& value)
+		{
+			m_Parameters[handle] = value;
+		}
+
+		A_CUDA_CPUGPU inline void SetParameter(const SDFParameterHandle handle, const glm::mat4& value)
+		{
+			for (int column = 0; column < 4; column++)
+			{
+				m_Parameters[handle + column] = value[column];
+			}
+		}
+
+		A_CUDA_CPUGPU inline const VectorType& GetParameter(const SDFParameterHandle handle) const
+		{
+			return m_Parameters[handle];
+		}
+
+		A_CUDA_CPUGPU inline int GetInstructionCount() const
+		{
+			return m_InstructionCount;
+		}
+
+	private:
+
+		// Each point of a batch adds a full set of register files to the thread. They are indexed at runtime, so on the GPU they live in
+		// local memory, which is why stencil batches are bounded by MAX_STENCIL_BATCH_SIZE.
+		template <int BATCH>
+		A_CUDA_CPUGPU inline void ExecuteDistances(const VectorType* positions, float* outDistances) const
+		{
+			static_assert(BATCH <= MAX_STENCIL_BATCH_SIZE, "Stencil batch exceeds the register budget of a GPU thread");
+			Execute<BATCH, false>(positions, outDistances, nullptr);
+		}
+
+		//////////////////////////////////////////////////////////////////////////
+
+		template <int BATCH, bool TRACK_LOCAL_POSITION>
+		A_CUDA_CPUGPU void Execute(const VectorType* positions, float* outDistances, VectorType* outLocalPositions) const
+		{
+			VectorType	positionRegisters[MAX_POSITION_REGISTERS][BATCH];
+			float		distanceRegisters[MAX_DISTANCE_REGISTERS][BATCH];
+			VectorType	localRegisters[TRACK_LOCAL_POSITION ? MAX_DISTANCE_REGISTERS : 1][BATCH];
+
+			for (int b = 0; b < BATCH; b++)
+			{
+				positionRegisters[0][b] = positions[b];
+			}
+
+			for (int i = 0; i < m_InstructionCount; i++)
+			{
+				const SDFInstruction instruction	= m_Instructions[i];
+				const VectorType* parameters		= &m_Parameters[instruction.Parameter];
+
+				const int target	= instruction.Target;
+				const int sourceA	= instruction.SourceA;
+				const int sourceB	= instruction.SourceB;
+
+				switch (instruction.OpCode)
+				{
+					//////////////////////////////////////////////////////////////////////////
+					// Primitives
+
+					case SDFOpCode::Box:
+					{
+						const VectorType extents = parameters[0];
+						for (int b = 0; b < BATCH; b++)
+						{
+							const VectorType q					= Math::Abs(positionRegisters[sourceA][b]) - extents;
+							distanceRegisters[target][b]		= Math::Min(Math::MaxComponent(q), 0.0f) + Math::Length(Math::Max(q, VectorType(0.0f)));
+							if constexpr (TRACK_LOCAL_POSITION)	{ localRegisters[target][b] = positionRegisters[sourceA][b]; }
+						}
+						break;
+					}
+					case SDFOpCode::HyperSphere:
+					{
+						const float radius = parameters[0].x;
+						for (int b = 0; b < BATCH; b++)
+						{
+							distanceRegisters[target][b]		= Math::Length(positionRegisters[sourceA][b]) - radius;
+							if constexpr (TRACK_LOCAL_POSITION)	{ localRegisters[target][b] = positionRegisters[sourceA][b]; }
+						}
+						break;
+					}
+
+					//////////////////////////////////////////////////////////////////////////
+					// Position modifiers
+
+					case SDFOpCode::Translation:
+					{
+						const VectorType translation = parameters[0];
+						for (int b = 0; b < BATCH; b++)
+						{
+							positionRegisters[target][b] = positionRegisters[sourceA][b] - translation;
+						}
+						break;
+					}
+					case SDFOpCode::Transformation4x4:
+					{
+						const glm::mat4 transformation = glm::mat4(parameters[0], parameters[1], parameters[2], parameters[3]);
+						for (int b = 0; b < BATCH; b++)
+						{
+							positionRegisters[target][b] = transformation * positionRegisters[sourceA][b];
+						}
+						break;
+					}
+					case SDFOpCode::Repetition:
+					{
+						const VectorType spacing = parameters[0];
+						for (int b = 0; b < BATCH; b++)
+						{
+							positionRegisters[target][b] = glm::mod(positionRegisters[sourceA][b] + 0.5f * spacing, spacing) - 0.5f * spacing;
+						}
+						break;
+					}
+					case SDFOpCode::FiniteRepetition:
+					{
+						const VectorType spacing	= parameters[0];
+						const VectorType span		= parameters[1];
+						for (int b = 0; b < BATCH; b++)
+						{
+							const VectorType& position		= positionRegisters[sourceA][b];
+							positionRegisters[target][b]	= position - spacing * glm::clamp(glm::round(position / spacing), -span, span);
+						}
+						break;
+					}
+
+					//////////////////////////////////////////////////////////////////////////
+					// Distance modifiers
+
+					case SDFOpCode::Onion:
+					{
+						const float thickness = parameters[0].x;
+						for (int b = 0; b < BATCH; b++)
+						{
+							distanceRegisters[target][b]		= Math::Abs(distanceRegisters[sourceA][b]) - thickness;
+							if constexpr (TRACK_LOCAL_POSITION)	{ localRegisters[target][b] = localRegisters[sourceA][b]; }
+						}
+						break;
+					}
+					case SDFOpCode::Union:
+					case SDFOpCode::Intersection:
+					case SDFOpCode::Substraction:
+					{
+						for (int b = 0; b < BATCH; b++)
+						{
+							const float lhs = distanceRegisters[sourceA][b];
+							const float rhs = distanceRegisters[sourceB][b];
+
+							bool takeLHS;
+							float distance;
+							if (instruction.OpCode == SDFOpCode::Union)
+							{
+								takeLHS		= lhs <= rhs;
+								distance	= takeLHS ? lhs : rhs;
+							}
+							else if (instruction.OpCode == SDFOpCode::Intersection)
+							{
+								takeLHS		= lhs >= rhs;
+								distance	= takeLHS ? lhs : rhs;
+							}
+							else
+							{
+								// Substracts lhs from rhs
+								takeLHS		= -lhs >= rhs;
+								distance	= takeLHS ? -lhs : rhs;
+							}
+
+							distanceRegisters[target][b]		= distance;
+							if constexpr (TRACK_LOCAL_POSITION)	{ localRegisters[target][b] = takeLHS ? localRegisters[sourceA][b] : localRegisters[sourceB][b]; }
+						}
+						break;
+					}
+					case SDFOpCode::SmoothUnion:
+					case SDFOpCode::SmoothIntersection:
+					case SDFOpCode::SmoothSubstraction:
+					{
+						const float smoothness = parameters[0].x;
+						for (int b = 0; b < BATCH; b++)
+						{
+							const float lhs = distanceRegisters[sourceA][b];
+							const float rhs = distanceRegisters[sourceB][b];
+
+							// Mirrors the SDFSmooth* templates. The local position is blended with the same operands and weight as the distance.
+							float h, distance, localOffset;
+							VectorType localLHS = VectorType(0.0f);
+							VectorType localRHS = VectorType(0.0f);
+							if constexpr (TRACK_LOCAL_POSITION)	{ localLHS = localRegisters[sourceA][b]; localRHS = localRegisters[sourceB][b]; }
+							if (instruction.OpCode == SDFOpCode::SmoothUnion)
+							{
+								h			= Math::Clamp01(0.5f + 0.5f * (rhs - lhs) / smoothness);
+								distance	= Math::UnclampedLerp(rhs, lhs, h) - smoothness * h * (1.0f - h);
+								localOffset	= -smoothness * h * (1.0f - h);
+							}
+							else if (instruction.OpCode == SDFOpCode::SmoothIntersection)
+							{
+								h			= Math::Clamp01(0.5f - 0.5f * (rhs - lhs) / smoothness);
+								distance	= Math::UnclampedLerp(rhs, lhs, h) + smoothness * h * (1.0f - h);
+								localOffset	= smoothness * h * (1.0f - h);
+							}
+							else
+							{
+								h			= Math::Clamp01(0.5f - 0.5f * (lhs + rhs) / smoothness);
+								distance	= Math::UnclampedLerp(rhs, -lhs, h) + smoothness * h * (1.0f - h);	// < Substracts lhs from rhs
+								localOffset	= smoothness * h * (1.0f - h);
+								localLHS	= -localLHS;
+							}
+
+							distanceRegisters[target][b]		= distance;
+							if constexpr (TRACK_LOCAL_POSITION)	{ localRegisters[target][b] = glm::mix(localRHS, localLHS, h) + localOffset; }
+						}
+						break;
+					}
+				}
+			}
+
+			for (int b = 0; b < BATCH; b++)
+			{
+				outDistances[b] = distanceRegisters[0][b];
+				if constexpr (TRACK_LOCAL_POSITION) { outLocalPositions[b] = localRegisters[0][b]; }
+			}
+		}
+
+		//////////////////////////////////////////////////////////////////////////
+
+		SDFInstruction	m_Instructions[MAX_INSTRUCTIONS];
+		VectorType		m_Parameters[MAX_PARAMETERS];
+		int				m_InstructionCount	= 0;
+		int				m_ParameterCount	= 0;
+	};
+
+	//////////////////////////////////////////////////////////////////////////
+	// SDF Program Builder
+	// Records an SDF tree into a program in post order. Position modifiers apply to everything recorded until their matching
+	// PopPosition(), booleans combine the two most recently recorded subtrees.
+	//
+	//	builder.PushTranslation(translation);
+	//		builder.AddBox(extents);
+	//	builder.PopPosition();
+	//	builder.AddHyperSphere(radius);
+	//	builder.Union();
+	//////////////////////////////////////////////////////////////////////////
+
+	class SDFProgramBuilder
+	{
+	public:
+		SDFProgramBuilder() = delete;
+		explicit SDFProgramBuilder(SDFProgram& program) : m_Program(program)
+		{
+			m_Program.m_InstructionCount	= 0;
+			m_Program.m_ParameterCount		= 0;
+		}
+
+		//////////////////////////////////////////////////////////////////////////
+		// Primitives
+
+		SDFParameterHandle AddBox(const glm::vec4& extents)
+		{
+			return AddPrimitive(SDFOpCode::Box, extents);
+		}
+
+		SDFParameterHandle AddHyperSphere(const float radius)
+		{
+			return AddPrimitive(SDFOpCode::HyperSphere, glm::vec4(radius, 0.0f, 0.0f, 0.0f));
+		}
+
+		//////////////////////////////////////////////////////////////////////////
+		// Position modifiers
+
+		SDFParameterHandle PushTranslation(const glm::vec4& translation)
+		{
+			const SDFParameterHandle handle = AddParameter(translation);
+			PushPosition(SDFOpCode::Translation, handle);
+			return handle;
+		}
+
+		SDFParameterHandle PushTransformation(const glm::mat4& transformation)
+		{
+			const SDFParameterHandle handle = AddParameter(transformation[0]);
+			AddParameter(transformation[1]);
+			AddParameter(transformation[2]);
+			AddParameter(transformation[3]);
+			PushPosition(SDFOpCode::Transformation4x4, handle);
+			return handle;
+		}
+
+		SDFParameterHandle PushRepetition(const glm::vec4& spacing)
+		{
+			const SDFParameterHandle handle = AddParameter(spacing);
+			PushPosition(SDFOpCode::Repetition, handle);
+			return handle;
+		}
+
+		SDFParameterHandle PushFiniteRepetition(const glm::vec4& spacing, const glm::vec4& span)
+		{
+			const SDFParameterHandle handle = AddParameter(spacing);
+			AddParameter(span);
+			PushPosition(SDFOpCode::FiniteRepetition, handle);
+			return handle;
+		}
+
+		void PopPosition()
+		{
+			assert(m_PositionDepth > 0 && "PopPosition called without a matching Push");
+			m_PositionDepth--;
+		}
+
+		//////////////////////////////////////////////////////////////////////////
+		// Distance modifiers
+
+		SDFParameterHandle Onion(const float thickness)
+		{
+			assert(m_DistanceDepth > 0 && "Onion needs a recorded subtree");
+
+			const SDFParameterHandle handle = AddParameter(glm::vec4(thickness, 0.0f, 0.0f, 0.0f));
+			const unsigned char top			= static_cast<unsigned char>(m_DistanceDepth - 1);
+			AddInstruction(SDFOpCode::Onion, top, top, 0, handle);
+			return handle;
+		}
+
+		void Union()											{ AddBoolean(SDFOpCode::Union, 0.0f); }
+		void Intersection()										{ AddBoolean(SDFOpCode::Intersection, 0.0f); }
+		void Substraction()										{ AddBoolean(SDFOpCode::Substraction, 0.0f); }
+		SDFParameterHandle SmoothUnion(const float smoothness)			{ return AddBoolean(SDFOpCode::SmoothUnion, smoothness); }
+		SDFParameterHandle SmoothIntersection(const float smoothness)	{ return AddBoolean(SDFOpCode::SmoothIntersection, smoothness); }
+		SDFParameterHandle SmoothSubstraction(const float smoothness)	{ return AddBoolean(SDFOpCode::SmoothSubstraction, smoothness); }
+
+		//////////////////////////////////////////////////////////////////////////
+
+		// True if the recorded tree is complete, meaning all positions were popped and exactly one distance remains.
+		bool IsComplete() const
+		{
+			return m_PositionDepth == 0 && m_DistanceDepth == 1;
+		}
+
+	private:
+
+		SDFParameterHandle AddParameter(const glm::vec4& value)
+		{
+			assert(m_Program.m_ParameterCount < SDFProgram::MAX_PARAMETERS && "SDFProgram parameter pool is full");
+
+			m_Program.m_Parameters[m_Program.m_ParameterCount] = value;
+			return static_cast<SDFParameterHandle>(m_Program.m_ParameterCount++);
+		}
+
+		void AddInstruction(const SDFOpCode opCode, const unsigned char target, const unsigned char sourceA, const unsigned char sourceB, const SDFParameterHandle parameter)
+		{
+			assert(m_Program.m_InstructionCount < SDFProgram::MAX_INSTRUCTIONS && "SDFProgram instruction stream is full");
+
+			SDFInstruction& instruction	= m_Program.m_Instructions[m_Program.m_InstructionCount++];
+			instruction.OpCode			= opCode;
+			instruction.Target			= target;
+			instruction.SourceA			= sourceA;
+			instruction.SourceB			= sourceB;
+			instruction.Parameter		= parameter;
+		}
+
+		SDFParameterHandle AddPrimitive(const SDFOpCode opCode, const glm::vec4& parameter)
+		{
+			assert(m_DistanceDepth < SDFProgram::MAX_DISTANCE_REGISTERS && "SDFProgram ran out of distance registers");
+
+			const SDFParameterHandle handle = AddParameter(parameter);
+			AddInstruction(opCode, static_cast<unsigned char>(m_DistanceDepth), static_cast<unsigned char>(m_PositionDepth), 0, handle);
+			m_DistanceDepth++;
+			return handle;
+		}
+
+		void PushPosition(const SDFOpCode opCode, const SDFParameterHandle handle)
+		{
+			assert(m_PositionDepth + 1 < SDFProgram::MAX_POSITION_REGISTERS && "SDFProgram ran out of position registers");
+
+			AddInstruction(opCode, static_cast<unsigned char>(m_PositionDepth + 1), static_cast<unsigned char>(m_PositionDepth), 0, handle);
+			m_PositionDepth++;
+		}
+
+		SDFParameterHandle AddBoolean(const SDFOpCode opCode, const float smoothness)
+		{
+			assert(m_DistanceDepth > 1 && "Booleans need two recorded subtrees");
+
+			const SDFParameterHandle handle = AddParameter(glm::vec4(smoothness, 0.0f, 0.0f, 0.0f));
+			const unsigned char lhs			= static_cast<unsigned char>(m_DistanceDepth - 2);
+			const unsigned char rhs			= static_cast<unsigned char>(m_DistanceDepth - 1);
+			AddInstruction(opCode, lhs, lhs, rhs, handle);
+			m_DistanceDepth--;
+			return handle;
+		}
+
+		//////////////////////////////////////////////////////////////////////////
+
+		SDFProgram&	m_Program;
+		int			m_PositionDepth = 0;
+		int			m_DistanceDepth = 0;
+	};
+
+	//////////////////////////////////////////////////////////////////////////
+}
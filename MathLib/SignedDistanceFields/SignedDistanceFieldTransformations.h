@@ -87,6 +87,13 @@ namespace Math
 
 		//////////////////////////////////////////////////////////////////////////
 
+		A_CUDA_CPUGPU inline const glm::mat4& GetTransformationMatrix() const
+		{
+			return m_Transformation;
+		}
+
+		//////////////////////////////////////////////////////////////////////////
+
 		A_CUDA_CPUGPU inline float EvaluateDistance(const VectorType& position) const
 		{
 			if constexpr (std::is_same<typename T::VectorType, glm::vec3>::value)
@@ -116,4 +123,138 @@ namespace Math
 
 	//////////////////////////////////////////////////////////////////////////
 
+	// Evaluates its child at (transformation * position + offset). Created by MakeTranslation / MakeTransformation when they
+	// fuse adjacent translation and transformation nodes, so a whole chain costs a single mat4 * vec4 and add per evaluation.
+	template <class T>
+	class SDFAffine : public SignedDistanceField
+	{
+		static_assert(std::is_same_v<typename T::VectorType, glm::vec4>, "SDFAffine only supports 4D SDFs");
+
+	public:
+		using VectorType = typename T::VectorType;
+		using ResultType = SDFEvaluateResult<VectorType>;
+
+		SDFAffine() = delete;
+		A_CUDA_CPUGPU explicit SDFAffine(T&& sdf, const glm::mat4x4& transformation, const VectorType& offset) :
+			m_SDF(std::move(sdf)), m_Transformation(transformation), m_Offset(offset) {}
+
+		A_CUDA_CPUGPU T& GetSDF() { return m_SDF; }
+
+		//////////////////////////////////////////////////////////////////////////
+
+		// Same result as SDFTranslation<SDFTransformation4x4<T>>: The position is translated first, then transformed.
+		A_CUDA_CPUGPU inline void SetTranslationAndTransformation(const VectorType& translation, const glm::mat4& transformation)
+		{
+			m_Transformation	= transformation;
+			m_Offset			= -(transformation * translation);
+		}
+
+		//////////////////////////////////////////////////////////////////////////
+
+		A_CUDA_CPUGPU inline float EvaluateDistance(const VectorType& position) const
+		{
+			return m_SDF.EvaluateDistance(m_Transformation * position + m_Offset);
+		}
+
+		//////////////////////////////////////////////////////////////////////////
+		
+		A_CUDA_CPUGPU inline VectorType GetLocalSamplePosition(const VectorType& position) const
+		{
+			return m_SDF.GetLocalSamplePosition(m_Transformation * position + m_Offset);
+		}
+
+		//////////////////////////////////////////////////////////////////////////
+
+		A_CUDA_CPUGPU inline const glm::mat4& GetTransformationMatrix() const
+		{
+			return m_Transformation;
+		}
+
+		A_CUDA_CPUGPU inline const VectorType& GetOffset() const
+		{
+			return m_Offset;
+		}
+
+		// The position that is mapped onto the origin of the child.
+		A_CUDA_CPUGPU inline VectorType GetTranslation() const
+		{
+			return -(glm::inverse(m_Transformation) * m_Offset);
+		}
+
+	private:
+		T			m_SDF;
+		glm::mat4x4	m_Transformation;
+		VectorType	m_Offset;
+	};
+
+	//////////////////////////////////////////////////////////////////////////
+	// Rewrites
+	// Use these instead of constructing SDFTranslation / SDFTransformation4x4 directly. Adjacent nodes are fused while the
+	// tree is built, so the resulting type has fewer levels than the written chain:
+	//
+	//	Translation<Translation<T>>			-> Translation<T>
+	//	Transformation<Transformation<T>>	-> Transformation<T>
+	//	Translation<Transformation<T>>		-> Affine<T>
+	//	Transformation<Translation<T>>		-> Affine<T>
+	//	Translation / Transformation<Affine<T>>	-> Affine<T>
+	//
+	// Identity values can only be elided by not creating the node, as the values are not known at compile time.
+	//////////////////////////////////////////////////////////////////////////
+
+	template <class T>
+	inline SDFTranslation<T> MakeTranslation(T&& sdf, const typename T::VectorType& translation)
+	{
+		static_assert(!std::is_lvalue_reference_v<T>, "The SDF is moved into the new node, pass it as rvalue");
+		return SDFTranslation<T>(std::move(sdf), translation);
+	}
+
+	template <class T>
+	inline SDFTranslation<T> MakeTranslation(SDFTranslation<T>&& sdf, const typename T::VectorType& translation)
+	{
+		return SDFTranslation<T>(std::move(sdf.GetSDF()), sdf.GetTranslation() + translation);
+	}
+
+	template <class T, class = std::enable_if_t<std::is_same_v<typename T::VectorType, glm::vec4>>>
+	inline SDFAffine<T> MakeTranslation(SDFTransformation4x4<T>&& sdf, const glm::vec4& translation)
+	{
+		const glm::mat4 transformation = sdf.GetTransformationMatrix();
+		return SDFAffine<T>(std::move(sdf.GetSDF()), transformation, -(transformation * translation));
+	}
+
+	template <class T>
+	inline SDFAffine<T> MakeTranslation(SDFAffine<T>&& sdf, const glm::vec4& translation)
+	{
+		const glm::mat4 transformation = sdf.GetTransformationMatrix();
+		return SDFAffine<T>(std::move(sdf.GetSDF()), transformation, sdf.GetOffset() - transformation * translation);
+	}
+
+	//////////////////////////////////////////////////////////////////////////
+
+	template <class T>
+	inline SDFTransformation4x4<T> MakeTransformation(T&& sdf, const glm::mat4& transformation)
+	{
+		static_assert(!std::is_lvalue_reference_v<T>, "The SDF is moved into the new node, pass it as rvalue");
+		return SDFTransformation4x4<T>(std::move(sdf), transformation);
+	}
+
+	template <class T>
+	inline SDFTransformation4x4<T> MakeTransformation(SDFTransformation4x4<T>&& sdf, const glm::mat4& transformation)
+	{
+		return SDFTransformation4x4<T>(std::move(sdf.GetSDF()), sdf.GetTransformationMatrix() * transformation);
+	}
+
+	template <class T, class = std::enable_if_t<std::is_same_v<typename T::VectorType, glm::vec4>>>
+	inline SDFAffine<T> MakeTransformation(SDFTranslation<T>&& sdf, const glm::mat4& transformation)
+	{
+		return SDFAffine<T>(std::move(sdf.GetSDF()), transformation, -sdf.GetTranslation());
+	}
+
+	template <class T>
+	inline SDFAffine<T> MakeTransformation(SDFAffine<T>&& sdf, const glm::mat4& transformation)
+	{
+		return SDFAffine<T>(std::move(sdf.GetSDF()), sdf.GetTransformationMatrix() * transformation, sdf.GetOffset());
+	}
+
+	//////////////////////////////////////////////////////////////////////////
+
 }
\ No newline at end of file
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <glm\ext\vector_float4.hpp>
+#include <glm\ext\matrix_float4x4.hpp>
+
+#include "MathLib/Types/Hyperplane.h"
+#include "Rendering/CUDATypes.h"
+
+namespace Math
+{
+	// Intersection of up to MAX_HALFSPACES half-spaces.
+	struct ConvexPolytope
+	{
+		static constexpr int MAX_HALFSPACES = 16;
+
+		Hyperplane HalfSpaces[MAX_HALFSPACES];
+		int HalfSpaceCount = 0;
+
+		//////////////////////////////////////////////////////////////////////////
+
+		ConvexPolytope() = default;
+
+		//////////////////////////////////////////////////////////////////////////
+
+		A_CUDA_CPUGPU inline bool AddHalfSpace(const Hyperplane& halfSpace)
+		{
+			if (HalfSpaceCount >= MAX_HALFSPACES)
+			{
+				return false;
+			}
+
+			HalfSpaces[HalfSpaceCount++] = halfSpace;
+			return true;
+		}
+
+		//////////////////////////////////////////////////////////////////////////
+
+		// Same box as SDFAffine<SDFBox>: The position is translated first, then transformed, and lies inside if |local| <= extents per axis.
+		A_CUDA_CPUGPU static ConvexPolytope FromBox(const glm::vec4& translation, const glm::mat4& transformation, const glm::vec4& extents)
+		{
+			ConvexPolytope polytope;
+			for (int i = 0; i < 4; i++)
+			{
+				// Row i of the transformation maps the position onto local axis i.
+				const glm::vec4 row		= glm::vec4(transformation[0][i], transformation[1][i], transformation[2][i], transformation[3][i]);
+				const float rowLength	= glm::length(row);
+				const glm::vec4 normal	= row / rowLength;
+				const float center		= glm::dot(normal, translation);
+				const float extent		= extents[i] / rowLength;
+
+				polytope.AddHalfSpace(Hyperplane( normal,  center + extent));
+				polytope.AddHalfSpace(Hyperplane(-normal, -center + extent));
+			}
+			return polytope;
+		}
+	};
+}
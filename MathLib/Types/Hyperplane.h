@@ -0,0 +1,28 @@
+#pragma once
+
+#include <glm\ext\vector_float4.hpp>
+#include <glm\geometric.hpp>
+
+#include "Rendering/CUDATypes.h"
+
+namespace Math
+{
+	// Bounds the half-space of all points with dot(Normal, point) <= Distance. The normal points out of it and is expected to be normalized.
+	struct Hyperplane
+	{
+		glm::vec4 Normal	= glm::vec4(0.0f, 1.0f, 0.0f, 0.0f);
+		float Distance		= 0.0f;
+
+		//////////////////////////////////////////////////////////////////////////
+
+		Hyperplane() = default;
+		A_CUDA_CPUGPU explicit Hyperplane(const glm::vec4& normal, const float distance) : Normal(normal), Distance(distance) {}
+
+		//////////////////////////////////////////////////////////////////////////
+
+		A_CUDA_CPUGPU inline float EvaluateDistance(const glm::vec4& position) const
+		{
+			return glm::dot(Normal, position) - Distance;
+		}
+	};
+}
@@ -1,5 +1,7 @@
 #include "stdafx.h"
 
+#include <cstring>
+
 #include "Configuration.h"
 
 const char* Configuration::s_DrawModeNames[(int)DrawMode::Count] = {
@@ -30,4 +32,109 @@ const char* Configuration::s_AxisNames[5] = {
 	"y",
 	"z",
 	"w"
-};
\ No newline at end of file
+};
+
+const char* Configuration::s_ShadowRateNames[3] = {
+	"Full",
+	"Half",
+	"Quarter"
+};
+
+const char* Configuration::s_VariableRateNames[3] = {
+	"Off",
+	"2x2",
+	"4x4"
+};
+
+const char* Configuration::s_SceneEvaluatorNames[3] = {
+	"Templates",
+	"SDF Program",
+	"Generated"
+};
+
+const char* Configuration::s_SceneObjectAccelerationNames[2] = {
+	"Hierarchy",
+	"Instance Grid"
+};
+
+//////////////////////////////////////////////////////////////////////////
+
+unsigned int Configuration::GetRequiredHitAttributes(DrawMode drawMode)
+{
+	switch (drawMode)
+	{
+		case DrawMode::Shaded:
+		case DrawMode::ShadedNoFog:
+		case DrawMode::SimpleLitSurface:	return HitAttribute_LocalPosition | HitAttribute_Normal | HitAttribute_Shadow;
+		case DrawMode::SimpleLit:			return HitAttribute_Shadow;
+		case DrawMode::NormalFast:
+		case DrawMode::NormalConfigurable:	return HitAttribute_Normal;
+		case DrawMode::LocalPosition:
+		case DrawMode::Checker:				return HitAttribute_LocalPosition;
+		case DrawMode::ColoredChecker:
+		case DrawMode::Surfaces:			return HitAttribute_LocalPosition | HitAttribute_Normal;
+		case DrawMode::W_Heat:				return HitAttribute_LocalPosition | HitAttribute_Shadow;
+		default:							return HitAttribute_None;
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+bool Configuration::RequiresRemarch(const Configuration& previous) const
+{
+	// The G-buffer only holds the attributes the previous draw mode asked for.
+	const unsigned int missingAttributes = GetRequiredHitAttributes() & ~previous.GetRequiredHitAttributes();
+
+	return (missingAttributes & ~HitAttribute_Shadow) != 0	||
+		   MAX_STEPS				!= previous.MAX_STEPS				||
+		   MAX_DEPTH				!= previous.MAX_DEPTH				||
+		   RAY_HIT_EPSILON			!= previous.RAY_HIT_EPSILON			||
+		   MIN_STEP_SIZE			!= previous.MIN_STEP_SIZE			||
+		   VariableRateShift		!= previous.VariableRateShift		||
+		   UseProgressiveRefinement	!= previous.UseProgressiveRefinement	||
+		   UseAnalyticIntersection	!= previous.UseAnalyticIntersection	||
+		   SceneEvaluatorID			!= previous.SceneEvaluatorID		||
+		   SceneObjectCount			!= previous.SceneObjectCount		||
+		   SceneObjectAccelerationID	!= previous.SceneObjectAccelerationID	||
+		   SceneUseBrickCache		!= previous.SceneUseBrickCache		||
+		   std::memcmp(SceneSliderRotations, previous.SceneSliderRotations, sizeof(SceneSliderRotations)) != 0 ||
+		   std::memcmp(SceneSliderPositions, previous.SceneSliderPositions, sizeof(SceneSliderPositions)) != 0;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+bool Configuration::RequiresShadowUpdate(const Configuration& previous) const
+{
+	const unsigned int missingAttributes = GetRequiredHitAttributes() & ~previous.GetRequiredHitAttributes();
+
+	return (missingAttributes & HitAttribute_Shadow) != 0	||
+		   SHADOW_START_OFFSET		!= previous.SHADOW_START_OFFSET		||
+		   SHADOW_RAY_HIT_EPSILON	!= previous.SHADOW_RAY_HIT_EPSILON	||
+		   MAX_STEPS_SHADOW			!= previous.MAX_STEPS_SHADOW		||
+		   SHADOW_PENUMBRA			!= previous.SHADOW_PENUMBRA			||
+		   UseShadowVisibilityGrid	!= previous.UseShadowVisibilityGrid	||
+		   ShadowRateShift			!= previous.ShadowRateShift			||
+		   UseShadowRayPackets		!= previous.UseShadowRayPackets		||
+		   UseStochasticShadows		!= previous.UseStochasticShadows	||
+		   ShadowRayBudget			!= previous.ShadowRayBudget			||
+		   LIGHT_CULL_IMPORTANCE	!= previous.LIGHT_CULL_IMPORTANCE;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+bool Configuration::RequiresAmbientOcclusionUpdate(const Configuration& previous) const
+{
+	return UseAmbientOcclusion				!= previous.UseAmbientOcclusion				||
+		   AmbientOcclusionMaxFrames		!= previous.AmbientOcclusionMaxFrames		||
+		   AMBIENT_OCCLUSION_TAP_COUNT		!= previous.AMBIENT_OCCLUSION_TAP_COUNT		||
+		   AMBIENT_OCCLUSION_TAP_SPACING	!= previous.AMBIENT_OCCLUSION_TAP_SPACING	||
+		   AMBIENT_OCCLUSION_CONE_TAN		!= previous.AMBIENT_OCCLUSION_CONE_TAN;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+bool Configuration::HasChanged(const Configuration& previous) const
+{
+	// The previous configuration is always a byte copy of this one, so padding bytes match as well.
+	return std::memcmp(this, &previous, sizeof(Configuration)) != 0;
+}
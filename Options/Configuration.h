@@ -18,11 +18,42 @@ struct Configuration
 	RELEASE_CONST float	SHADOW_RAY_HIT_EPSILON	= 0.2f;
 	RELEASE_CONST int	MAX_STEPS_SHADOW		= 800;
 	RELEASE_CONST float	SHADOW_PENUMBRA			= 2.0f;
+
+	int					VariableRateShift		= 0;		// < Only every (1 << VariableRateShift)-th pixel per axis is marched up front. Blocks between uniform anchors are interpolated.
+	bool				UseProgressiveRefinement	= false;	// < Changed frames only march every 4th pixel per axis, the following frames fill in the rest.
+	RELEASE_CONST int	PROGRESSIVE_COARSEST_SHIFT	= 2;
+
+	bool				UseAnalyticIntersection	= false;	// < Scenes made of planes, hyperspheres and convex polytopes are intersected in closed form instead of marched.
+
+	bool				UseShadowVisibilityGrid	= false;	// < Look shadows up in a precomputed grid instead of marching them per pixel. Pays off while light and scene are static.
+	int					ShadowRateShift			= 0;		// < Shadow rays are cast for every (1 << ShadowRateShift)-th pixel per axis and upsampled in between.
+	bool				UseShadowRayPackets		= true;		// < March the shadow rays of a warp as a packet through a shared cone towards the light.
+
+	bool				UseStochasticShadows				= false;	// < Hard shadow rays towards random points of the light, accumulated over frames. Replaces the penumbra estimate.
+	int					StochasticShadowSamplesPerFrame		= 1;
+	int					StochasticShadowMaxSamples			= 64;		// < Accumulation stops once this many samples were taken, unless something moves.
+
+	int					ShadowRayBudget			= 2;		// < Shadow rays per pixel over all lights. The key light always takes one, the most important other lights share the rest.
+	RELEASE_CONST float	LIGHT_CULL_IMPORTANCE	= 0.01f;	// < Lights contributing less than this at a hit point are skipped.
 											
 	RELEASE_CONST float	CHECKERBOARD_SIZE		= 10.0f;
 
 	RELEASE_CONST float	AMBIENT_LIGHT_AMOUNT	= 0.4f;
 
+	bool				UseAmbientOcclusion				= false;	// < Darkens the ambient light by a few SDF taps along the normal. Only for draw modes with normals.
+	int					AmbientOcclusionMaxFrames		= 16;		// < Frames with jittered taps that are averaged while the G-buffer stays the same.
+	RELEASE_CONST int	AMBIENT_OCCLUSION_TAP_COUNT		= 4;
+	RELEASE_CONST float	AMBIENT_OCCLUSION_TAP_SPACING	= 2.0f;
+	RELEASE_CONST float	AMBIENT_OCCLUSION_CONE_TAN		= 0.6f;		// < Width of the cone around the normal that the jittered taps are spread over.
+
+	bool				UseEdgeSupersampling		= false;	// < Extra jittered birays for pixels on silhouettes, depth jumps and creases.
+	int					EdgeSupersamplingSamples	= 4;
+	RELEASE_CONST float	EDGE_DEPTH_THRESHOLD		= 0.05f;	// < Depth difference to a neighbour, relative to the depth, that counts as an edge.
+	RELEASE_CONST float	EDGE_NORMAL_THRESHOLD		= 0.8f;		// < Neighbours whose normals have a smaller dot product form a crease.
+
+	bool				UseProgressiveAntiAliasing		= false;	// < Keeps rendering jittered frames into a history while nothing changes.
+	int					ProgressiveAntiAliasingFrames	= 32;		// < Accumulation stops after this many frames.
+
 	//////////////////////////////////////////////////////////////////////////
 	// Visualization
 
@@ -53,6 +84,24 @@ struct Configuration
 
 	static const char* s_DrawModeNames[(int) DrawMode::Count];
 	static const char* s_AxisNames[5];
+	static const char* s_ShadowRateNames[3];
+	static const char* s_VariableRateNames[3];
+	static const char* s_SceneEvaluatorNames[3];
+	static const char* s_SceneObjectAccelerationNames[2];
+
+	// Hit attributes a draw mode reads. The march kernels are specialized on these and skip everything else.
+	enum HitAttributes : unsigned int
+	{
+		HitAttribute_None			= 0,
+		HitAttribute_LocalPosition	= 1 << 0,
+		HitAttribute_Normal			= 1 << 1,	// The local normal is computed if both the local position and the normal are requested.
+		HitAttribute_Shadow			= 1 << 2,
+
+		HitAttribute_All			= HitAttribute_LocalPosition | HitAttribute_Normal | HitAttribute_Shadow
+	};
+
+	static unsigned int GetRequiredHitAttributes(DrawMode drawMode);
+	unsigned int GetRequiredHitAttributes() const { return GetRequiredHitAttributes(DrawModeHit); }
 
 	DrawMode	DrawModeHit						= DrawMode::Shaded;
 	DrawMode	DrawModeMiss					= DrawMode::Shaded;
@@ -75,10 +124,32 @@ struct Configuration
 
 	float		SceneSpeed						= 0.6f;
 
+	// SceneEvaluator used by the scene, see s_SceneEvaluatorNames.
+	int			SceneEvaluatorID				= 0;
+	// Number of additional objects scattered around the cube.
+	int			SceneObjectCount				= 0;
+	// SceneObjectAcceleration of these objects, see s_SceneObjectAccelerationNames.
+	int			SceneObjectAccelerationID		= 0;
+	// Caches the distance to these objects in sparse bricks near their surface, see RenderVoxelBufferDataCUDA.
+	bool		SceneUseBrickCache				= false;
+
 	//////////////////////////////////////////////////////////////////////////
 
 	// Experiments
 
 	Colors::ColorScheme ActiveColorScheme			= Colors::GenerateColorScheme(42);
 
+	//////////////////////////////////////////////////////////////////////////
+
+	// Frame invalidation
+	
+	// True if a setting changed that alters primary hits, meaning the G-buffer is outdated.
+	bool RequiresRemarch(const Configuration& previous) const;
+	// True if a setting changed that alters shadows, but not primary hits.
+	bool RequiresShadowUpdate(const Configuration& previous) const;
+	// True if a setting changed that alters the ambient occlusion, but not primary hits.
+	bool RequiresAmbientOcclusionUpdate(const Configuration& previous) const;
+	// True if any setting changed. Settings that do not require a remarch only affect the shading pass.
+	bool HasChanged(const Configuration& previous) const;
+
 };
\ No newline at end of file
@@ -40,6 +40,8 @@ void OptionsManager::DrawDebugWindows(Application& application, Configuration& c
 				application.ActiveQuiltConfiguration = static_cast<QuiltConfiguration>(activeQuiltConfiguration);
 			}
 
+			ImGui::Checkbox("Per-View Level of Detail", &application.UseViewLevelOfDetail);
+
 		#ifdef _DEBUG
 
 			ImGui::InputInt("Max Steps",				&config.MAX_STEPS);
@@ -110,8 +112,69 @@ void OptionsManager::DrawDebugWindows(Application& application, Configuration& c
 			ImGui::SliderFloat("ScaleFactor FOV Z", &application.m_DesiredCameraPaneScaleZ, 0.01f, 10.0f);
 			ImGui::SliderFloat("ScaleFactor FOV W", &application.m_DesiredCameraPaneScaleW, 0.01f, 10.0f);
 	
-			ImGui::SliderFloat4("Light Position", &application.m_DesiredLightPosition.x, -150.0f, 150.0f);
-			ImGui::SliderFloat("Light Radius", &application.m_DesiredLightRadius, 1.0f, 1000.0f);
+			LightList<DimensionVector>& lights = application.m_DesiredLights;
+			for (int i = 0; i < lights.LightCount; i++)
+			{
+				ImGui::PushID(i);
+				if (ImGui::TreeNode("Light", i == 0 ? "Key Light" : "Light %i", i))
+				{
+					Light<DimensionVector>& light = lights.Lights[i];
+					ImGui::SliderFloat4("Light Position", &light.Position.x, -150.0f, 150.0f);
+					ImGui::SliderFloat("Light Radius", &light.Radius, 1.0f, 1000.0f);
+					ImGui::SliderFloat("Light Intensity", &light.Intensity, 0.0f, 2.0f);
+					ImGui::Checkbox("Casts Shadows", &light.CastsShadows);
+					ImGui::TreePop();
+				}
+				ImGui::PopID();
+			}
+			if (lights.LightCount < LightList<DimensionVector>::MAX_LIGHT_COUNT && ImGui::Button("Add Light"))
+			{
+				const Light<DimensionVector>& keyLight = lights.GetKeyLight();
+				lights.Lights[lights.LightCount].Initialize(-keyLight.Position, keyLight.Radius, keyLight.AreaRadius, 0.5f);
+				lights.LightCount++;
+			}
+			if (lights.LightCount > 1)
+			{
+				ImGui::SameLine();
+				if (ImGui::Button("Remove Light"))
+				{
+					lights.LightCount--;
+				}
+			}
+			ImGui::SliderInt("Shadow Rays per Pixel", &config.ShadowRayBudget, 1, LightList<DimensionVector>::MAX_LIGHT_COUNT);
+
+			ImGui::Combo("Variable Rate", &config.VariableRateShift, Configuration::s_VariableRateNames, 3);
+			ImGui::Checkbox("Progressive Refinement", &config.UseProgressiveRefinement);
+			ImGui::Checkbox("Analytic Intersection", &config.UseAnalyticIntersection);
+			ImGui::Checkbox("Shadow Visibility Grid", &config.UseShadowVisibilityGrid);
+			ImGui::Combo("Shadow Rate", &config.ShadowRateShift, Configuration::s_ShadowRateNames, 3);
+			ImGui::Checkbox("Shadow Ray Packets", &config.UseShadowRayPackets);
+
+			ImGui::Checkbox("Stochastic Area Shadows", &config.UseStochasticShadows);
+			if (config.UseStochasticShadows)
+			{
+				ImGui::SliderFloat("Light Area Radius", &lights.Lights[0].AreaRadius, 0.0f, 50.0f);
+				ImGui::SliderInt("Shadow Samples per Frame", &config.StochasticShadowSamplesPerFrame, 1, 2);
+				ImGui::SliderInt("Shadow Max Samples", &config.StochasticShadowMaxSamples, 1, 256);
+			}
+
+			ImGui::Checkbox("Ambient Occlusion", &config.UseAmbientOcclusion);
+			if (config.UseAmbientOcclusion)
+			{
+				ImGui::SliderInt("Ambient Occlusion Frames", &config.AmbientOcclusionMaxFrames, 1, 64);
+			}
+
+			ImGui::Checkbox("Edge Supersampling", &config.UseEdgeSupersampling);
+			if (config.UseEdgeSupersampling)
+			{
+				ImGui::SliderInt("Edge Samples", &config.EdgeSupersamplingSamples, 2, 8);
+			}
+
+			ImGui::Checkbox("Progressive Anti-Aliasing", &config.UseProgressiveAntiAliasing);
+			if (config.UseProgressiveAntiAliasing)
+			{
+				ImGui::SliderInt("Anti-Aliasing Frames", &config.ProgressiveAntiAliasingFrames, 1, 128);
+			}
 			ImGui::EndTabItem();
 		}
 		
@@ -214,6 +277,16 @@ void OptionsManager::DrawDebugWindows(Application& application, Configuration& c
 				config.SceneSliderPositions[i] = 0.0f;
 			}
 		}
+
+		ImGui::Combo("Evaluator", &config.SceneEvaluatorID, Configuration::s_SceneEvaluatorNames, 3);
+		ImGui::DragInt("Object Count", &config.SceneObjectCount, 10.0f, 0, 50000);
+		ImGui::Combo("Object Acceleration", &config.SceneObjectAccelerationID, Configuration::s_SceneObjectAccelerationNames, 2);
+		ImGui::Checkbox("Object Brick Cache", &config.SceneUseBrickCache);
+		if (config.SceneUseBrickCache)
+		{
+			// Band cells without a brick still pay for the lookup and are then evaluated exactly.
+			ImGui::Text("Bricks: %i of %i, %i band cells overflow", application.m_BrickCacheBrickCount, RenderVoxelBufferDataCUDA::MAX_BRICKS, application.m_BrickCacheOverflowCount);
+		}
 			ImGui::EndTabItem();
 		}
 		
@@ -31,7 +31,7 @@
 Application* Application::s_Instance;
 
 // CUDA Functions defined in Application.cu
-extern void CUDA_RenderImage(RenderPixelBufferDataCUDA* bufferData, RenderSceneDataCUDA* sceneData, Configuration* config, Camera<glm::vec4>* camera, Light<glm::vec4>* light);
+extern void CUDA_RenderImage(RenderPixelBufferDataCUDA* bufferData, RenderSceneDataCUDA* sceneData, Configuration* config, Camera<glm::vec4>* camera, Camera<glm::vec4>* previousShadowCamera, LightList<glm::vec4>* lights, RenderShadowGridDataCUDA* shadowGrid, RenderVoxelBufferDataCUDA* voxelGrid, RenderInvalidation invalidation);
 extern void CUDA_PrepareRenderImage(RenderingBuffer& raymarchingBuffer, cudaSurfaceObject_t& outSurfaceObject);
 extern void CUDA_FinishRenderImage(RenderingBuffer& raymarchingBuffer);
 
@@ -123,7 +123,8 @@ void Application::InitManagers()
 	m_OptionsManager	= new OptionsManager();
 	m_StudyManager		= new StudyManager();
 
-	mh_Configuration = new Configuration();
+	mh_Configuration			= new Configuration();
+	mh_LastFrameConfiguration	= new Configuration();
 	cudaMalloc(reinterpret_cast<void**> (&md_Configuration), sizeof(Configuration));
 }
 
@@ -133,6 +134,7 @@ void Application::CleanupManagers()
 {
 	cudaFree(mh_Configuration);
 	delete mh_Configuration;
+	delete mh_LastFrameConfiguration;
 
 	delete m_StudyManager;
 	delete m_OptionsManager;
@@ -289,7 +291,7 @@ void Application::InitRendering()
 	//////////////////////////////////////////////////////////////////////////
 
 	// Initialize Render Data
-	CUDA_CHECK_ERROR(cudaMallocManaged(reinterpret_cast<void**>(&mcm_RenderBufferData), sizeof(decltype(mcm_RenderBufferData))));
+	CUDA_CHECK_ERROR(cudaMallocManaged(reinterpret_cast<void**>(&mcm_RenderBufferData), sizeof(RenderPixelBufferDataCUDA)));
 	CUDA_CHECK_ERROR(cudaMallocManaged(reinterpret_cast<void**>(&mcm_RenderSceneData), sizeof(decltype(mcm_RenderSceneData))));
 
 	//////////////////////////////////////////////////////////////////////////
@@ -315,16 +317,41 @@ void Application::InitRendering()
 		CUDA_CHECK_ERROR(cudaGraphicsGLRegisterImage(&buffer.d_CUDAGraphicsResource, buffer.TextureHandle, GL_TEXTURE_2D, cudaGraphicsRegisterFlagsSurfaceLoadStore /*cudaGraphicsMapFlagsWriteDiscard*/));
 	}
 
+	AllocateViewBuffers();
+
 	//////////////////////////////////////////////////////////////////////////
 
 	// Light
 	
-	CUDA_CHECK_ERROR(cudaMallocManaged(reinterpret_cast<void**>(&mcm_Light), sizeof(decltype(mcm_Light))));
+	CUDA_CHECK_ERROR(cudaMallocManaged(reinterpret_cast<void**>(&mcm_Lights), sizeof(LightList<DimensionVector>)));
+
+	m_DesiredLights = LightList<DimensionVector>();
+	m_DesiredLights.Lights[0].Initialize({107, 75, -23, 30}, 100.0f, 8.0f);
+	m_DesiredLights.LightCount = 1;
+
+	*mcm_Lights = m_DesiredLights;
+
+	// Shadow Grid
+
+	CUDA_CHECK_ERROR(cudaMallocManaged(reinterpret_cast<void**>(&mcm_ShadowGrid), sizeof(RenderShadowGridDataCUDA)));
+	CUDA_CHECK_ERROR(cudaMalloc(reinterpret_cast<void**>(&md_ShadowGridVisibility), RenderShadowGridDataCUDA::CELL_COUNT * sizeof(float)));
+
+	*mcm_ShadowGrid = RenderShadowGridDataCUDA();
+	mcm_ShadowGrid->Initialize(md_ShadowGridVisibility);
 
-	m_DesiredLightPosition	= {107, 75, -23, 30};
-	m_DesiredLightRadius	= 100.0f;
+	// Brick Cache
+	// Managed, as the scene may also be evaluated on the host.
 
-	mcm_Light->Initialize(m_DesiredLightPosition, m_DesiredLightRadius);
+	CUDA_CHECK_ERROR(cudaMallocManaged(reinterpret_cast<void**>(&mcm_VoxelGridData), sizeof(RenderVoxelBufferDataCUDA)));
+	CUDA_CHECK_ERROR(cudaMallocManaged(reinterpret_cast<void**>(&mcm_VoxelGridBuffer), RenderVoxelBufferDataCUDA::MAX_BRICKS * sizeof(RenderVoxelDataCUDA)));
+	CUDA_CHECK_ERROR(cudaMallocManaged(reinterpret_cast<void**>(&mcm_VoxelGridBrickTable), RenderVoxelBufferDataCUDA::CELL_COUNT * sizeof(int)));
+	CUDA_CHECK_ERROR(cudaMallocManaged(reinterpret_cast<void**>(&mcm_VoxelGridCellDistances), RenderVoxelBufferDataCUDA::CELL_COUNT * sizeof(float)));
+	CUDA_CHECK_ERROR(cudaMallocManaged(reinterpret_cast<void**>(&mcm_VoxelGridBrickCells), (RenderVoxelBufferDataCUDA::MAX_BRICKS + 1) * sizeof(int)));
+	cudaDeviceSynchronize();
+
+	*mcm_VoxelGridData = RenderVoxelBufferDataCUDA();
+	mcm_VoxelGridData->Initialize(mcm_VoxelGridBuffer, mcm_VoxelGridBrickTable, mcm_VoxelGridCellDistances, mcm_VoxelGridBrickCells);
+	mcm_Scene->SetObjectCache(mcm_VoxelGridData);
 
 	//////////////////////////////////////////////////////////////////////////
 
@@ -348,6 +375,9 @@ void Application::InitRendering()
 	const float viewPaneDistance		= CAMERA_DISTANCE;
 
 	mcm_Camera->Initialize(camPos, fovVert, viewConeHorizontal, aspectRatio, rotMat * forward, rotMat * right, rotMat * up, rotMat * over, viewPaneDistance, m_DesiredCameraProjectionMethodMain, m_DesiredCameraProjectionMethodSecondary);
+
+	CUDA_CHECK_ERROR(cudaMallocManaged(reinterpret_cast<void**>(&mcm_PreviousShadowCamera), sizeof(Camera<DimensionVector>)));
+	*mcm_PreviousShadowCamera = *mcm_Camera;
 }
 
 //////////////////////////////////////////////////////////////////////////
@@ -390,6 +420,39 @@ void Application::ReInitRendering(QuiltConfiguration option)
 
 		CUDA_CHECK_ERROR(cudaGraphicsGLRegisterImage(&buffer.d_CUDAGraphicsResource, buffer.TextureHandle, GL_TEXTURE_2D, cudaGraphicsRegisterFlagsSurfaceLoadStore /*cudaGraphicsMapFlagsWriteDiscard*/));
 	}
+
+	// 2b) View Atlas & G-buffer
+	AllocateViewBuffers();
+	m_InvalidateNextFrame = true;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void Application::AllocateViewBuffers()
+{
+	// Always allocated for full resolution views, so that toggling the level of detail does not need a reallocation.
+	if (md_ViewAtlas != nullptr)
+	{
+		CUDA_CHECK_ERROR(cudaFree(md_ViewAtlas));
+		CUDA_CHECK_ERROR(cudaFree(md_GBuffer));
+		CUDA_CHECK_ERROR(cudaFree(md_ShadowHistory[0]));
+		CUDA_CHECK_ERROR(cudaFree(md_ShadowHistory[1]));
+		CUDA_CHECK_ERROR(cudaFree(md_EdgePixels));
+		CUDA_CHECK_ERROR(cudaFree(md_EdgePixelCount));
+		CUDA_CHECK_ERROR(cudaFree(md_AntiAliasingHistory));
+	}
+
+	const unsigned int pixelCount = m_QuiltConfigData.GetMaxAtlasPixelCount();
+	CUDA_CHECK_ERROR(cudaMalloc(reinterpret_cast<void**>(&md_ViewAtlas), pixelCount * sizeof(uchar4)));
+	CUDA_CHECK_ERROR(cudaMalloc(reinterpret_cast<void**>(&md_GBuffer), pixelCount * sizeof(PackedRayMarchResult)));
+	CUDA_CHECK_ERROR(cudaMalloc(reinterpret_cast<void**>(&md_ShadowHistory[0]), pixelCount * sizeof(ShadowHistorySample)));
+	CUDA_CHECK_ERROR(cudaMalloc(reinterpret_cast<void**>(&md_ShadowHistory[1]), pixelCount * sizeof(ShadowHistorySample)));
+
+	// Edges are a small fraction of the pixels. Edges beyond the capacity are simply not supersampled.
+	m_EdgePixelCapacity = pixelCount / 4;
+	CUDA_CHECK_ERROR(cudaMalloc(reinterpret_cast<void**>(&md_EdgePixels), m_EdgePixelCapacity * sizeof(EdgePixel)));
+	CUDA_CHECK_ERROR(cudaMalloc(reinterpret_cast<void**>(&md_EdgePixelCount), sizeof(unsigned int)));
+	CUDA_CHECK_ERROR(cudaMalloc(reinterpret_cast<void**>(&md_AntiAliasingHistory), pixelCount * sizeof(glm::vec4)));
 }
 
 //////////////////////////////////////////////////////////////////////////
@@ -398,11 +461,29 @@ void Application::CleanupRendering()
 {
 	// Camera
 	CUDA_CHECK_ERROR(cudaFree(mcm_Camera));
+	CUDA_CHECK_ERROR(cudaFree(mcm_PreviousShadowCamera));
 
 	// Light
-	CUDA_CHECK_ERROR(cudaFree(mcm_Light));
+	CUDA_CHECK_ERROR(cudaFree(mcm_Lights));
+	CUDA_CHECK_ERROR(cudaFree(md_ShadowGridVisibility));
+	CUDA_CHECK_ERROR(cudaFree(mcm_ShadowGrid));
+
+	// Brick Cache
+	mcm_Scene->SetObjectCache(nullptr);
+	CUDA_CHECK_ERROR(cudaFree(mcm_VoxelGridBuffer));
+	CUDA_CHECK_ERROR(cudaFree(mcm_VoxelGridBrickTable));
+	CUDA_CHECK_ERROR(cudaFree(mcm_VoxelGridCellDistances));
+	CUDA_CHECK_ERROR(cudaFree(mcm_VoxelGridBrickCells));
+	CUDA_CHECK_ERROR(cudaFree(mcm_VoxelGridData));
 
 	// Cleanup Render Data
+	CUDA_CHECK_ERROR(cudaFree(md_ShadowHistory[0]));
+	CUDA_CHECK_ERROR(cudaFree(md_ShadowHistory[1]));
+	CUDA_CHECK_ERROR(cudaFree(md_EdgePixels));
+	CUDA_CHECK_ERROR(cudaFree(md_EdgePixelCount));
+	CUDA_CHECK_ERROR(cudaFree(md_AntiAliasingHistory));
+	CUDA_CHECK_ERROR(cudaFree(md_GBuffer));
+	CUDA_CHECK_ERROR(cudaFree(md_ViewAtlas));
 	CUDA_CHECK_ERROR(cudaFree(mcm_RenderSceneData));
 	CUDA_CHECK_ERROR(cudaFree(mcm_RenderBufferData));
 }
@@ -561,13 +642,14 @@ void Application::MarchSample(int id, float percentageX, float percentageY, floa
 	
 	if (result2.Hit)
 	{
-		const glm::vec4 toLightPosition	= mcm_Light->Position - result2.Position;
+		const Light<DimensionVector>& keyLight = mcm_Lights->GetKeyLight();
+		const glm::vec4 toLightPosition	= keyLight.Position - result2.Position;
 		const float toLightDistance	= glm::length(toLightPosition);
 		const glm::vec4 toLightPositionN = toLightPosition / toLightDistance;
 
 		// Shadow Ray
 		const Math::Ray<glm::vec4> shadowRay	= Math::Ray<glm::vec4>(result2.Position + toLightPositionN * mh_Configuration->SHADOW_START_OFFSET, toLightPositionN);
-		result2.ShadowValue						= RayMarchFunctions::MarchSecondaryShadowRay<glm::vec4>(shadowRay, mcm_RenderSceneData, toLightDistance, mcm_Light->Radius, mh_Configuration->MAX_STEPS_SHADOW, mh_Configuration->SHADOW_RAY_HIT_EPSILON, mh_Configuration->SHADOW_PENUMBRA);
+		result2.ShadowValue						= RayMarchFunctions::MarchSecondaryShadowRay<glm::vec4>(shadowRay, mcm_RenderSceneData, toLightDistance, keyLight.Radius, mh_Configuration->MAX_STEPS_SHADOW, mh_Configuration->SHADOW_RAY_HIT_EPSILON, mh_Configuration->SHADOW_PENUMBRA);
 	}
 
 	const auto resultColor = VisualizationHelper::GetColorForRayResult(*mh_Configuration, result2);
@@ -649,6 +731,7 @@ A_CUDA_CPU void Application::MainLoop()
 	// 1) Setup buffers, threads	
 
 	QuiltConfiguration initializedQuiltConfiguration = ActiveQuiltConfiguration;
+	bool initializedViewLevelOfDetail				 = UseViewLevelOfDetail;
 
 	std::future<void> exitFuture = m_RaymarchThreadExitSignal.get_future();
 	m_RaymarchThread = std::thread(&RenderingThread, this, std::move(exitFuture));
@@ -656,7 +739,9 @@ A_CUDA_CPU void Application::MainLoop()
 	mt_IsWritingIntoBuffer[1] = true;
 	CUDA_PrepareRenderImage(m_RenderingBuffers[1], md_RenderingSurfaceObject);		
 	mcm_Scene->Update(*mh_Configuration);
-	mt_StartRender = true;
+	m_FrameInvalidation = GetFrameInvalidation(true, true);
+	m_IsFrameInFlight	= true;
+	mt_StartRender		= true;
 
 	// Wait for first render
 	while (mt_IsWritingIntoBuffer[1])
@@ -678,7 +763,7 @@ A_CUDA_CPU void Application::MainLoop()
 		unsigned int nextBufferID = (m_RenderingBufferIDMainThread + 1) % BUFFER_COUNT;
 
 		// Check for resolution changes
-		const bool quiltConfigurationChanged = initializedQuiltConfiguration != ActiveQuiltConfiguration;
+		const bool quiltConfigurationChanged = initializedQuiltConfiguration != ActiveQuiltConfiguration || initializedViewLevelOfDetail != UseViewLevelOfDetail;
 		if (quiltConfigurationChanged)
 		{
 			// Wait for all active renderings to finish.
@@ -693,6 +778,7 @@ A_CUDA_CPU void Application::MainLoop()
 			// Rebuild textures and buffers, restart at
 			ReInitRendering(ActiveQuiltConfiguration);
 			initializedQuiltConfiguration = ActiveQuiltConfiguration;
+			initializedViewLevelOfDetail  = UseViewLevelOfDetail;
 			std::this_thread::yield();
 
 			continue;
@@ -701,23 +787,34 @@ A_CUDA_CPU void Application::MainLoop()
 		//////////////////////////////////////////////////////////////////////////
 		// Check if a frame is ready to be uploaded and then displayed
 
-		bool nextFrameDone = !mt_IsWritingIntoBuffer[nextBufferID];
+		bool nextFrameDone = m_IsFrameInFlight && !mt_IsWritingIntoBuffer[nextBufferID];
 		if (nextFrameDone)
 		{
 			// 1) Free resources for finished frame
 			CUDA_FinishRenderImage(m_RenderingBuffers[nextBufferID]);
-			m_RenderingBufferIDMainThread = nextBufferID;
-			
+			m_RenderingBufferIDMainThread	= nextBufferID;
+			m_IsFrameInFlight				= false;
+		}
+
+		if (!m_IsFrameInFlight)
+		{
 			// 2) Update Scene
-			ApplyCameraInput();
-			ApplyLightInput();
+			const bool cameraChanged	= ApplyCameraInput();
+			const bool lightChanged		= ApplyLightInput();
 			mcm_Scene->Update(*mh_Configuration);
 
-			// 3) Lock resources for future frame
-			CUDA_PrepareRenderImage(m_RenderingBuffers[m_RenderingBufferIDRaymarchingThread], md_RenderingSurfaceObject);
+			// If nothing changed, the displayed frame is still up to date and we do not render at all.
+			m_FrameInvalidation = GetFrameInvalidation(cameraChanged, lightChanged);
+			if (m_FrameInvalidation != RenderInvalidation::None)
+			{
+				// 3) Lock resources for future frame
+				CUDA_PrepareRenderImage(m_RenderingBuffers[m_RenderingBufferIDRaymarchingThread], md_RenderingSurfaceObject);
 			
-			// 4) Signal raymarching thread
-			mt_StartRender = true;
+				// 4) Signal raymarching thread
+				m_IsFrameInFlight = true;
+				mt_IsWritingIntoBuffer[m_RenderingBufferIDRaymarchingThread] = true;
+				mt_StartRender = true;
+			}
 
 			GL_CHECK_ERROR();
 		}
@@ -871,8 +968,16 @@ float lastSamplePercentageX = 0.0f;
 float lastSamplePercentageY = 0.0f;
 float lastSampleViewPercentage = 0.0f;
 
-void Application::ApplyCameraInput()
+bool Application::ApplyCameraInput()
 {
+	const bool cameraChanged = mcm_Camera->PrimaryProjectionMethod		!= m_DesiredCameraProjectionMethodMain		||
+							   mcm_Camera->SecondaryProjectionMethod	!= m_DesiredCameraProjectionMethodSecondary	||
+							   mcm_Camera->ViewPanePrimarySizeFactor	!= m_DesiredCameraPaneScaleZ					||
+							   mcm_Camera->ViewPaneSecondarySizeFactor	!= m_DesiredCameraPaneScaleW					||
+							   mcm_Camera->m_Last4DLatitude				!= m_CameraAngleZW							||
+							   mcm_Camera->m_Last3DLatitude				!= m_CameraAngleYZ							||
+							   mcm_Camera->m_LastLongitude				!= m_CameraAngleXY;
+
 	mcm_Camera->PrimaryProjectionMethod		= m_DesiredCameraProjectionMethodMain;
 	mcm_Camera->SecondaryProjectionMethod	= m_DesiredCameraProjectionMethodSecondary;
 	
@@ -920,14 +1025,135 @@ void Application::ApplyCameraInput()
 	m_LastCameraUp			= mcm_Camera->UpVector;
 	m_LastCameraForward		= mcm_Camera->ForwardVector;
 	m_LastCameraOver		= mcm_Camera->OverVector;
+
+	return cameraChanged;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+bool Application::ApplyLightInput()
+{
+	const bool lightChanged = *mcm_Lights != m_DesiredLights;
+
+	*mcm_Lights = m_DesiredLights;
+
+	return lightChanged;
 }
 
 //////////////////////////////////////////////////////////////////////////
 
-void Application::ApplyLightInput()
+RenderInvalidation Application::GetFrameInvalidation(const bool cameraChanged, const bool lightChanged)
 {
-	mcm_Light->Position = m_DesiredLightPosition;
-	mcm_Light->Radius	= m_DesiredLightRadius;
+	RenderInvalidation invalidation = RenderInvalidation::None;
+	if (m_InvalidateNextFrame || cameraChanged || mh_Configuration->RequiresRemarch(*mh_LastFrameConfiguration))
+	{
+		invalidation = RenderInvalidation::Geometry;
+	}
+	else if (lightChanged || mh_Configuration->RequiresShadowUpdate(*mh_LastFrameConfiguration))
+	{
+		invalidation = RenderInvalidation::Lighting;
+	}
+	else if (mh_Configuration->HasChanged(*mh_LastFrameConfiguration))
+	{
+		invalidation = RenderInvalidation::Shading;
+	}
+
+	// The brick cache is filled a few bricks per frame, so frames keep coming until it is complete.
+	if (mcm_VoxelGridData->IsEnabled && mcm_VoxelGridData->IsDirty && invalidation < RenderInvalidation::Shading)
+	{
+		invalidation = RenderInvalidation::Shading;
+	}
+
+	// Progressive refinement: changed frames march at the coarsest rate, every following frame halves the stride until the variable rate is reached.
+	// Refining frames redo everything after the march, but keep the shadow grid and the shadow history, as neither camera nor scene changed.
+	const unsigned int variableRateShift	= static_cast<unsigned int>(mh_Configuration->VariableRateShift);
+	const unsigned int coarsestShift		= static_cast<unsigned int>(mh_Configuration->PROGRESSIVE_COARSEST_SHIFT);
+	const bool isRefinementPending			= mh_Configuration->UseProgressiveRefinement && invalidation < RenderInvalidation::Geometry && m_MarchRateShift > variableRateShift;
+	m_IsProgressiveRefinement = false;
+	if (isRefinementPending)
+	{
+		invalidation				= RenderInvalidation::Geometry;
+		m_MarchRateShift			= m_MarchRateShift - 1;
+		m_IsProgressiveRefinement	= true;
+	}
+	else if (invalidation >= RenderInvalidation::Geometry)
+	{
+		m_MarchRateShift = mh_Configuration->UseProgressiveRefinement && variableRateShift < coarsestShift ? coarsestShift : variableRateShift;
+	}
+
+	// The shadow grid and the stochastic shadow history do not depend on the camera, so they are only discarded if the light or the scene changed.
+	const bool shadowsChanged = m_InvalidateNextFrame || lightChanged || mh_Configuration->RequiresRemarch(*mh_LastFrameConfiguration) || mh_Configuration->RequiresShadowUpdate(*mh_LastFrameConfiguration);
+	if (shadowsChanged)
+	{
+		mcm_ShadowGrid->IsDirty		= true;
+		m_PendingShadowHistoryReset	= true;
+	}
+
+	// Stochastic shadows keep rendering frames until enough samples are accumulated.
+	// After camera changes, disoccluded pixels start from zero again, so the count restarts as well.
+	const bool castsStochasticShadows = mh_Configuration->UseStochasticShadows && (mh_Configuration->GetRequiredHitAttributes() & Configuration::HitAttribute_Shadow) != 0;
+	if (castsStochasticShadows)
+	{
+		if (shadowsChanged || cameraChanged)
+		{
+			m_AccumulatedShadowFrames = 0;
+		}
+
+		const bool isConverged = m_AccumulatedShadowFrames * mh_Configuration->StochasticShadowSamplesPerFrame >= static_cast<unsigned int>(mh_Configuration->StochasticShadowMaxSamples);
+		if (!isConverged && invalidation < RenderInvalidation::Lighting)
+		{
+			invalidation = RenderInvalidation::Lighting;
+		}
+
+		if (invalidation >= RenderInvalidation::Lighting)
+		{
+			m_ShadowFrameIndex++;
+			m_AccumulatedShadowFrames++;
+			m_ResetShadowHistory		= m_PendingShadowHistoryReset;
+			m_PendingShadowHistoryReset	= false;
+		}
+	}
+
+	// Ambient occlusion lives in the G-buffer, so it restarts with every march and is refined with jittered taps as long as nothing moves.
+	const bool usesAmbientOcclusion = mh_Configuration->UseAmbientOcclusion && (mh_Configuration->GetRequiredHitAttributes() & Configuration::HitAttribute_Normal) != 0;
+	m_ComputeAmbientOcclusion = false;
+	if (usesAmbientOcclusion)
+	{
+		if (invalidation >= RenderInvalidation::Geometry || mh_Configuration->RequiresAmbientOcclusionUpdate(*mh_LastFrameConfiguration))
+		{
+			m_AccumulatedAmbientOcclusionFrames = 0;
+		}
+
+		if (m_AccumulatedAmbientOcclusionFrames < static_cast<unsigned int>(mh_Configuration->AmbientOcclusionMaxFrames))
+		{
+			if (invalidation < RenderInvalidation::Shading)
+			{
+				invalidation = RenderInvalidation::Shading;
+			}
+
+			m_ComputeAmbientOcclusion	= true;
+			m_AmbientOcclusionFrame		= m_AccumulatedAmbientOcclusionFrames++;
+		}
+	}
+
+	// Anti-aliasing only accumulates into frames that would not be rendered otherwise, so any change or other refinement restarts it.
+	if (mh_Configuration->UseProgressiveAntiAliasing && invalidation == RenderInvalidation::None)
+	{
+		if (m_AntiAliasingFrame < static_cast<unsigned int>(mh_Configuration->ProgressiveAntiAliasingFrames))
+		{
+			invalidation = RenderInvalidation::Shading;
+			m_AntiAliasingFrame++;
+		}
+	}
+	else
+	{
+		m_AntiAliasingFrame = 0;
+	}
+
+	std::memcpy(mh_LastFrameConfiguration, mh_Configuration, sizeof(Configuration));
+	m_InvalidateNextFrame = false;
+
+	return invalidation;
 }
 
 //////////////////////////////////////////////////////////////////////////
@@ -960,16 +1186,38 @@ void Application::RenderingThread(Application* application, std::future<void> ex
 			application->m_QuiltConfigData.UsedTextureDimensions, 
 			application->m_QuiltConfigData.ViewDimensions, 
 			application->m_QuiltConfigData.Views);
+		application->mcm_RenderBufferData->InitializeViewAtlas(application->md_ViewAtlas, application->md_GBuffer, application->m_QuiltConfigData);
+		application->mcm_RenderBufferData->HitAttributes	= application->mh_Configuration->GetRequiredHitAttributes();
+		application->mcm_RenderBufferData->ShadowRateShift	= application->mh_Configuration->ShadowRateShift;
+		application->mcm_RenderBufferData->VariableRateShift	= application->mh_Configuration->VariableRateShift;
+		application->mcm_RenderBufferData->MarchRateShift		= application->m_MarchRateShift;
+		application->mcm_RenderBufferData->IsProgressiveRefinement	= application->m_IsProgressiveRefinement;
+		application->mcm_RenderBufferData->UseStochasticShadows	= application->mh_Configuration->UseStochasticShadows;
+		application->mcm_RenderBufferData->InitializeShadowHistory(
+			application->md_ShadowHistory[application->m_ShadowFrameIndex % 2], 
+			application->md_ShadowHistory[(application->m_ShadowFrameIndex + 1) % 2], 
+			application->m_ShadowFrameIndex, 
+			application->m_ResetShadowHistory);
+		application->mcm_ShadowGrid->IsEnabled = application->mh_Configuration->UseShadowVisibilityGrid;
+		application->mcm_RenderBufferData->InitializeEdgeList(application->md_EdgePixels, application->md_EdgePixelCount, application->m_EdgePixelCapacity);
+		application->mcm_RenderBufferData->UseEdgeSupersampling		= application->mh_Configuration->UseEdgeSupersampling;
+		application->mcm_RenderBufferData->d_AntiAliasingHistory	= application->md_AntiAliasingHistory;
+		application->mcm_RenderBufferData->AntiAliasingFrame		= application->m_AntiAliasingFrame;
+		application->mcm_RenderBufferData->ComputeAmbientOcclusion	= application->m_ComputeAmbientOcclusion;
+		application->mcm_RenderBufferData->AmbientOcclusionFrame	= application->m_AmbientOcclusionFrame;
 		
 		std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
 		cudaMemcpy(application->md_Configuration, application->mh_Configuration, sizeof(Configuration), cudaMemcpyHostToDevice);
 		
 		// 3) Wait for Render
-		CUDA_RenderImage(application->mcm_RenderBufferData, application->mcm_RenderSceneData, application->md_Configuration, application->mcm_Camera, application->mcm_Light);
+		CUDA_RenderImage(application->mcm_RenderBufferData, application->mcm_RenderSceneData, application->md_Configuration, application->mcm_Camera, application->mcm_PreviousShadowCamera, application->mcm_Lights, application->mcm_ShadowGrid, application->mcm_VoxelGridData, application->m_FrameInvalidation);
 		
 		std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
 		application->m_LastRayMarchingTimeMyS = std::chrono::duration_cast<std::chrono::microseconds>(end - begin);
 
+		application->m_BrickCacheBrickCount		= application->mcm_VoxelGridData->BrickCount;
+		application->m_BrickCacheOverflowCount	= application->mcm_VoxelGridData->OverflowCellCount;
+
 		// 4) Signal main thread to unlock resources and swap buffers
 		application->mt_IsWritingIntoBuffer[application->m_RenderingBufferIDRaymarchingThread] = false;
 		
@@ -1323,7 +1571,8 @@ void Application::SetupForNormalDisplay()
  
 void Application::ConfigureQuilt(QuiltConfiguration option)
 {
-	ActiveQuiltConfiguration = option;
+	ActiveQuiltConfiguration				= option;
+	m_QuiltConfigData.UseViewLevelOfDetail	= UseViewLevelOfDetail;
 	switch (option)
 	{	
 		case _16_singleView: m_QuiltConfigData.Initialize({16, 16}, {1, 1}, {16, 16}); return;			//  512 x 512 px for the single view
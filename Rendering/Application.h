@@ -68,6 +68,7 @@ private:
 
 	QuiltConfiguration	ActiveQuiltConfiguration;
 	bool				DrawQuiltInsteadOfLightfield = false;
+	bool				UseViewLevelOfDetail		 = false;		// < Render outer views with less resolution and quality
 
 	private:
 	QuiltConfigurationData	m_QuiltConfigData;
@@ -97,14 +98,46 @@ private:
 	cudaSurfaceObject_t									md_RenderingSurfaceObject;
 
 	RenderPixelBufferDataCUDA*							mcm_RenderBufferData;
+	uchar4*												md_ViewAtlas = nullptr;
+	PackedRayMarchResult*								md_GBuffer	 = nullptr;
+	std::array<ShadowHistorySample*, 2>					md_ShadowHistory = {};
+	EdgePixel*											md_EdgePixels = nullptr;
+	unsigned int*										md_EdgePixelCount = nullptr;
+	unsigned int										m_EdgePixelCapacity = 0;
+	glm::vec4*											md_AntiAliasingHistory = nullptr;
 	RenderSceneDataCUDA*								mcm_RenderSceneData;
 	Camera<DimensionVector>*							mcm_Camera;
-	Light<DimensionVector>*								mcm_Light;
+	Camera<DimensionVector>*							mcm_PreviousShadowCamera;		// < Camera of the last frame that cast stochastic shadows, used for reprojection.
+	LightList<DimensionVector>*							mcm_Lights;
+	RenderShadowGridDataCUDA*							mcm_ShadowGrid;
+	float*												md_ShadowGridVisibility = nullptr;
 	Configuration*										mh_Configuration;
 	Configuration*										md_Configuration;
+	Configuration*										mh_LastFrameConfiguration;
+
+	RenderInvalidation									m_FrameInvalidation					= RenderInvalidation::Geometry;
+	bool												m_InvalidateNextFrame				= true;		// < Forces the next frame to be fully rendered, e.g. after buffers were reallocated.
+	bool												m_IsFrameInFlight					= false;
+
+	unsigned int										m_ShadowFrameIndex					= 0;		// < Counts all frames that cast stochastic shadows.
+	unsigned int										m_AccumulatedShadowFrames			= 0;		// < Frames accumulated since the last light, scene or camera change.
+	bool												m_PendingShadowHistoryReset			= true;
+	bool												m_ResetShadowHistory				= true;
+
+	unsigned int										m_AccumulatedAmbientOcclusionFrames	= 0;		// < Frames accumulated since the last march.
+	unsigned int										m_AmbientOcclusionFrame				= 0;
+	bool												m_ComputeAmbientOcclusion			= false;
+
+	unsigned int										m_AntiAliasingFrame					= 0;		// < Jittered frames accumulated since the last change.
+
+	unsigned int										m_MarchRateShift					= 0;
+	bool												m_IsProgressiveRefinement			= false;
 
-	cudaArray_t											m_VoxelGridBuffer;
 	RenderVoxelBufferDataCUDA*							mcm_VoxelGridData;
+	RenderVoxelDataCUDA*								mcm_VoxelGridBuffer = nullptr;		// < Brick pool of the distance brick cache
+	int*												mcm_VoxelGridBrickTable = nullptr;
+	float*												mcm_VoxelGridCellDistances = nullptr;
+	int*												mcm_VoxelGridBrickCells = nullptr;
 
 	std::thread											m_RaymarchThread;
 	std::promise<void>									m_RaymarchThreadExitSignal;
@@ -171,8 +204,11 @@ public:
 	float				m_DesiredCameraPaneScaleZ = 1.0f;
 	float				m_DesiredCameraPaneScaleW = 1.0f;
 
-	DimensionVector		m_DesiredLightPosition;
-	float				m_DesiredLightRadius;
+	LightList<DimensionVector>	m_DesiredLights;
+
+	// Brick cache usage of the objects, shown in the options. Copied after each frame, as the grid itself lives in managed memory.
+	int					m_BrickCacheBrickCount		= 0;
+	int					m_BrickCacheOverflowCount	= 0;
 
 	//////////////////////////////////////////////////////////////////////////
 	// Camera Control
@@ -191,13 +227,15 @@ private:
 	A_CUDA_CPU void MainLoop();
 	A_CUDA_CPU void ProcessInput();
 	A_CUDA_CPU void ProcessCameraInput();
-	void ApplyCameraInput();
-	void ApplyLightInput();
+	bool ApplyCameraInput();
+	bool ApplyLightInput();
+	RenderInvalidation GetFrameInvalidation(const bool cameraChanged, const bool lightChanged);
 	
 	//////////////////////////////////////////////////////////////////////////
 	// Rendering
 
 	void ReInitRendering(QuiltConfiguration option);
+	void AllocateViewBuffers();
 
 	void InitRendering();
 	void CleanupRendering();
@@ -2,7 +2,9 @@
 
 #include <cuda_runtime.h>
 #include <device_launch_parameters.h>
+#include <algorithm>
 #include <cstdio>
+#include <cfloat>
 
 #include "GraphicsIncludes.h"
 
@@ -36,13 +38,86 @@ constexpr unsigned int RESULT_COLOR_COMPONENT_COUNT = 4;
 
 using N = glm::vec4;
 
-A_CUDA_KERNEL void k_RenderPixel(RenderPixelBufferDataCUDA* bufferData, RenderSceneDataCUDA* sceneData, Configuration* config, Camera<glm::vec4>* camera, Light<glm::vec4>* light);
+template <ProjectionMethod PRIMARY, ProjectionMethod SECONDARY, unsigned int HIT_ATTRIBUTES>
+A_CUDA_KERNEL void k_MarchPixel(RenderPixelBufferDataCUDA* bufferData, RenderSceneDataCUDA* sceneData, Configuration* config, Camera<glm::vec4>* camera);
+template <ProjectionMethod PRIMARY, ProjectionMethod SECONDARY, unsigned int HIT_ATTRIBUTES>
+A_CUDA_KERNEL void k_SupersampleEdges(RenderPixelBufferDataCUDA* bufferData, RenderSceneDataCUDA* sceneData, Configuration* config, Camera<glm::vec4>* camera);
+template <ProjectionMethod PRIMARY, ProjectionMethod SECONDARY, unsigned int HIT_ATTRIBUTES>
+A_CUDA_KERNEL void k_AccumulateAntiAliasing(RenderPixelBufferDataCUDA* bufferData, RenderSceneDataCUDA* sceneData, Configuration* config, Camera<glm::vec4>* camera);
+template <ProjectionMethod PRIMARY, ProjectionMethod SECONDARY, unsigned int HIT_ATTRIBUTES>
+A_CUDA_KERNEL void k_RefineVariableRate(RenderPixelBufferDataCUDA* bufferData, RenderSceneDataCUDA* sceneData, Configuration* config, Camera<glm::vec4>* camera);
+A_CUDA_KERNEL void k_DetectEdges(RenderPixelBufferDataCUDA* bufferData, Configuration* config, Camera<glm::vec4>* camera);
+A_CUDA_KERNEL void k_FillProgressive(RenderPixelBufferDataCUDA* bufferData);
+A_CUDA_KERNEL void k_ShadowPixel(RenderPixelBufferDataCUDA* bufferData, RenderSceneDataCUDA* sceneData, Configuration* config, Light<glm::vec4>* light, RenderShadowGridDataCUDA* shadowGrid);
+A_CUDA_KERNEL void k_UpsampleShadows(RenderPixelBufferDataCUDA* bufferData, RenderSceneDataCUDA* sceneData, Configuration* config, Light<glm::vec4>* light, RenderShadowGridDataCUDA* shadowGrid);
+A_CUDA_KERNEL void k_StochasticShadowPixel(RenderPixelBufferDataCUDA* bufferData, RenderSceneDataCUDA* sceneData, Configuration* config, Light<glm::vec4>* light, Camera<glm::vec4>* previousShadowCamera);
+A_CUDA_KERNEL void k_FillShadowGrid(RenderShadowGridDataCUDA* shadowGrid, RenderSceneDataCUDA* sceneData, Configuration* config, Light<glm::vec4>* light);
+A_CUDA_KERNEL void k_ClassifyVoxelBricks(RenderVoxelBufferDataCUDA* voxelGrid, RenderSceneDataCUDA* sceneData);
+A_CUDA_KERNEL void k_FillVoxelBricks(RenderVoxelBufferDataCUDA* voxelGrid, RenderSceneDataCUDA* sceneData, const int firstBrick, const int brickCount);
+A_CUDA_KERNEL void k_AdditionalLightsPixel(RenderPixelBufferDataCUDA* bufferData, RenderSceneDataCUDA* sceneData, Configuration* config, LightList<glm::vec4>* lights);
+A_CUDA_KERNEL void k_AmbientOcclusionPixel(RenderPixelBufferDataCUDA* bufferData, RenderSceneDataCUDA* sceneData, Configuration* config);
+A_CUDA_KERNEL void k_ShadePixel(RenderPixelBufferDataCUDA* bufferData, Configuration* config, Camera<glm::vec4>* camera);
+A_CUDA_KERNEL void k_PresentViewAtlas(RenderPixelBufferDataCUDA* bufferData);
 
-void CUDA_RenderImage(RenderPixelBufferDataCUDA* bufferData, RenderSceneDataCUDA* sceneData, Configuration* config, Camera<glm::vec4>* camera, Light<glm::vec4>* light);
+void CUDA_RenderImage(RenderPixelBufferDataCUDA* bufferData, RenderSceneDataCUDA* sceneData, Configuration* config, Camera<glm::vec4>* camera, Camera<glm::vec4>* previousShadowCamera, LightList<glm::vec4>* lights, RenderShadowGridDataCUDA* shadowGrid, RenderVoxelBufferDataCUDA* voxelGrid, RenderInvalidation invalidation);
 
 void CUDA_PrepareRenderImage(RenderingBuffer& RenderingBuffer, cudaSurfaceObject_t& outSurfaceObject);
 void CUDA_FinishRenderImage(RenderingBuffer& RenderingBuffer);
 
+////////////////////////////////////////////////////////////////
+// March kernel selection
+////////////////////////////////////////////////////////////////
+
+using MarchPixelKernel_t = void (*)(RenderPixelBufferDataCUDA*, RenderSceneDataCUDA*, Configuration*, Camera<glm::vec4>*);
+
+// All kernels that march primary birays take the same arguments and are specialized the same way.
+enum class MarchKernelType
+{
+	MarchPixel,
+	SupersampleEdges,
+	AccumulateAntiAliasing,
+	RefineVariableRate
+};
+
+template <ProjectionMethod PRIMARY, ProjectionMethod SECONDARY, unsigned int HIT_ATTRIBUTES>
+MarchPixelKernel_t SelectMarchPixelKernel(const MarchKernelType type)
+{
+	switch (type)
+	{
+		case MarchKernelType::SupersampleEdges:			return k_SupersampleEdges<PRIMARY, SECONDARY, HIT_ATTRIBUTES>;
+		case MarchKernelType::AccumulateAntiAliasing:	return k_AccumulateAntiAliasing<PRIMARY, SECONDARY, HIT_ATTRIBUTES>;
+		case MarchKernelType::RefineVariableRate:		return k_RefineVariableRate<PRIMARY, SECONDARY, HIT_ATTRIBUTES>;
+		default:										return k_MarchPixel<PRIMARY, SECONDARY, HIT_ATTRIBUTES>;
+	}
+}
+
+// Only the geometric attributes select a march kernel. Shadows are handled by skipping the shadow pass.
+template <ProjectionMethod PRIMARY, ProjectionMethod SECONDARY>
+MarchPixelKernel_t GetMarchPixelKernel(const unsigned int hitAttributes, const MarchKernelType type)
+{
+	switch (hitAttributes & (Configuration::HitAttribute_LocalPosition | Configuration::HitAttribute_Normal))
+	{
+		case Configuration::HitAttribute_None:			return SelectMarchPixelKernel<PRIMARY, SECONDARY, Configuration::HitAttribute_None>(type);
+		case Configuration::HitAttribute_LocalPosition:	return SelectMarchPixelKernel<PRIMARY, SECONDARY, Configuration::HitAttribute_LocalPosition>(type);
+		case Configuration::HitAttribute_Normal:		return SelectMarchPixelKernel<PRIMARY, SECONDARY, Configuration::HitAttribute_Normal>(type);
+		default:										return SelectMarchPixelKernel<PRIMARY, SECONDARY, Configuration::HitAttribute_LocalPosition | Configuration::HitAttribute_Normal>(type);
+	}
+}
+
+MarchPixelKernel_t GetMarchPixelKernel(const ProjectionMethod primary, const ProjectionMethod secondary, const unsigned int hitAttributes, const MarchKernelType type = MarchKernelType::MarchPixel)
+{
+	if (primary == ProjectionMethod::Perspectve)
+	{
+		return secondary == ProjectionMethod::Perspectve
+			? GetMarchPixelKernel<ProjectionMethod::Perspectve, ProjectionMethod::Perspectve>(hitAttributes, type)
+			: GetMarchPixelKernel<ProjectionMethod::Perspectve, ProjectionMethod::Parallel>(hitAttributes, type);
+	}
+
+	return secondary == ProjectionMethod::Perspectve
+		? GetMarchPixelKernel<ProjectionMethod::Parallel, ProjectionMethod::Perspectve>(hitAttributes, type)
+		: GetMarchPixelKernel<ProjectionMethod::Parallel, ProjectionMethod::Parallel>(hitAttributes, type);
+}
+
 ////////////////////////////////////////////////////////////////
 // Slice Rendering (4D -> 2D)
 ////////////////////////////////////////////////////////////////
@@ -79,16 +154,66 @@ void CUDA_FinishRenderImage(RenderingBuffer& RenderingBuffer)
 	}
 }
 
+// Classifies the cells of the brick cache in the first call after a change, then launches the fill of a limited number of bricks per call.
+// Returns the number of launched bricks, which are only counted as filled once the frame is synchronized, see CompleteVoxelGridUpdate.
+int UpdateVoxelGrid(RenderVoxelBufferDataCUDA* voxelGrid, RenderSceneDataCUDA* sceneData)
+{
+	constexpr unsigned int FILL_BLOCK_SIZE = 256;
+
+	if (!voxelGrid->IsClassified)
+	{
+		int* d_brickCounter = &voxelGrid->mcm_BrickCells[RenderVoxelBufferDataCUDA::MAX_BRICKS];
+		CUDA_CHECK_ERROR(cudaMemset(d_brickCounter, 0, sizeof(int)));
+		k_ClassifyVoxelBricks KERNEL_ARGS2((RenderVoxelBufferDataCUDA::CELL_COUNT + FILL_BLOCK_SIZE - 1) / FILL_BLOCK_SIZE, FILL_BLOCK_SIZE)(voxelGrid, sceneData);
+		cudaDeviceSynchronize();
+		CUDA_CHECK_ERROR(cudaGetLastError());
+
+		const int bandCellCount			= *d_brickCounter;
+		voxelGrid->BrickCount			= std::min(bandCellCount, RenderVoxelBufferDataCUDA::MAX_BRICKS);
+		voxelGrid->OverflowCellCount	= bandCellCount - voxelGrid->BrickCount;
+		voxelGrid->FilledBrickCount		= 0;
+		voxelGrid->IsClassified			= true;
+	}
+
+	const int firstBrick = voxelGrid->FilledBrickCount;
+	const int brickCount = std::min(RenderVoxelBufferDataCUDA::BRICKS_PER_FRAME, voxelGrid->BrickCount - firstBrick);
+	if (brickCount > 0)
+	{
+		const unsigned int sampleCount = brickCount * RenderVoxelDataCUDA::SAMPLE_COUNT;
+		k_FillVoxelBricks KERNEL_ARGS2((sampleCount + FILL_BLOCK_SIZE - 1) / FILL_BLOCK_SIZE, FILL_BLOCK_SIZE)(voxelGrid, sceneData, firstBrick, brickCount);
+	}
+	return brickCount;
+}
+
+// Needs to be called after the frame is synchronized, as the grid lives in managed memory.
+void CompleteVoxelGridUpdate(RenderVoxelBufferDataCUDA* voxelGrid, const int filledBrickCount)
+{
+	voxelGrid->FilledBrickCount += filledBrickCount;
+	if (voxelGrid->FilledBrickCount == voxelGrid->BrickCount)
+	{
+		voxelGrid->IsDirty = false;
+		voxelGrid->IsValid = true;
+	}
+}
+
+////////////////////////////////////////////////////////////////
+
 // May be called from any Thread
-void CUDA_RenderImage(RenderPixelBufferDataCUDA* bufferData, RenderSceneDataCUDA* sceneData, Configuration* config, Camera<glm::vec4>* camera, Light<glm::vec4>* light)
+void CUDA_RenderImage(RenderPixelBufferDataCUDA* bufferData, RenderSceneDataCUDA* sceneData, Configuration* config, Camera<glm::vec4>* camera, Camera<glm::vec4>* previousShadowCamera, LightList<glm::vec4>* lights, RenderShadowGridDataCUDA* shadowGrid, RenderVoxelBufferDataCUDA* voxelGrid, RenderInvalidation invalidation)
 {	
 	CUDA_CHECK_ERROR(cudaGetLastError());
 	
 	////////////////////////////////////////////////////////////////
 
 	//printf("Start Render Image\n");
+	// The views are rendered into the view atlas, one view per grid slice. Views with a lower resolution only use the first few blocks of their slice.
 	const dim3 threadsPerBlock	= dim3(BLOCK_SIZE_2D, BLOCK_SIZE_2D);
-	const dim3 numBlocks		= dim3(bufferData->BufferDimensions.x / BLOCK_SIZE_2D, bufferData->BufferDimensions.y /BLOCK_SIZE_2D);
+	const dim3 numBlocks		= dim3((bufferData->ViewDimensions.x + BLOCK_SIZE_2D - 1) / BLOCK_SIZE_2D, (bufferData->ViewDimensions.y + BLOCK_SIZE_2D - 1) / BLOCK_SIZE_2D, bufferData->ViewCount);
+	const unsigned int shadowRate	= 1u << bufferData->ShadowRateShift;
+	const dim3 numBlocksShadow	= dim3((bufferData->ViewDimensions.x + BLOCK_SIZE_2D * shadowRate - 1) / (BLOCK_SIZE_2D * shadowRate), (bufferData->ViewDimensions.y + BLOCK_SIZE_2D * shadowRate - 1) / (BLOCK_SIZE_2D * shadowRate), bufferData->ViewCount);
+	const unsigned int marchRate	= 1u << bufferData->MarchRateShift;
+	const dim3 numBlocksMarch	= dim3((bufferData->ViewDimensions.x + BLOCK_SIZE_2D * marchRate - 1) / (BLOCK_SIZE_2D * marchRate), (bufferData->ViewDimensions.y + BLOCK_SIZE_2D * marchRate - 1) / (BLOCK_SIZE_2D * marchRate), bufferData->ViewCount);
+	const dim3 numBlocksPresent	= dim3((bufferData->BufferDimensions.x + BLOCK_SIZE_2D - 1) / BLOCK_SIZE_2D, (bufferData->BufferDimensions.y + BLOCK_SIZE_2D - 1) / BLOCK_SIZE_2D);
 
 	constexpr bool SHOW_DEBUG = false;
 	if (SHOW_DEBUG)
@@ -98,16 +223,125 @@ void CUDA_RenderImage(RenderPixelBufferDataCUDA* bufferData, RenderSceneDataCUDA
 		cudaGetDeviceProperties(&properties, 0);
 		printf("using %i multiprocessors\n", properties.multiProcessorCount);
 		printf("max threads per processor: %i\n", properties.maxThreadsPerMultiProcessor);
-		printf("params: threadsPerBlock (%i, %i), numBlocks (%i, %i) \n", threadsPerBlock.x, threadsPerBlock.y, numBlocks.x, numBlocks.y);
+		printf("params: threadsPerBlock (%i, %i), numBlocks (%i, %i, %i) \n", threadsPerBlock.x, threadsPerBlock.y, numBlocks.x, numBlocks.y, numBlocks.z);
 	}
 
 	cudaDeviceSynchronize();
 	CUDA_CHECK_ERROR(cudaGetLastError());
 
-	k_RenderPixel KERNEL_ARGS2(numBlocks, threadsPerBlock)(bufferData, sceneData, config, camera, light);
+	// All of the buffers below are managed memory, which the host must not touch while a kernel runs. So everything the host needs
+	// is read and the shadow grid is fitted before the first launch, and the bookkeeping waits for the synchronize at the end of the frame.
+	const ProjectionMethod primaryProjection	= camera->PrimaryProjectionMethod;
+	const ProjectionMethod secondaryProjection	= camera->SecondaryProjectionMethod;
+	const unsigned int hitAttributes			= bufferData->HitAttributes;
+	const unsigned int variableRateShift		= bufferData->VariableRateShift;
+	const unsigned int marchRateShift			= bufferData->MarchRateShift;
+	const bool computeAmbientOcclusion			= bufferData->ComputeAmbientOcclusion;
+	const bool useStochasticShadows				= bufferData->UseStochasticShadows;
+	const bool useEdgeSupersampling				= bufferData->UseEdgeSupersampling;
+	const unsigned int antiAliasingFrame		= bufferData->AntiAliasingFrame;
+	unsigned int* const d_edgePixelCount		= bufferData->d_EdgePixelCount;
+
+	// The kernel is picked once per frame, so the per pixel work does not branch on the projection or on unused hit attributes.
+	const MarchPixelKernel_t marchPixelKernel	= GetMarchPixelKernel(primaryProjection, secondaryProjection, hitAttributes);
+	const bool requiresShadows					= (hitAttributes & Configuration::HitAttribute_Shadow) != 0;
+	Light<glm::vec4>* light						= &lights->Lights[0];
+	bool castStochasticShadows					= false;
+
+	const bool castKeyLightShadows				= requiresShadows && light->CastsShadows;
+
+	// The grid is only rebuilt if the light or the scene changed, camera movement keeps it.
+	bool fillShadowGrid = false;
+	if (castKeyLightShadows && !useStochasticShadows && invalidation >= RenderInvalidation::Lighting && shadowGrid->IsEnabled && shadowGrid->IsDirty)
+	{
+		shadowGrid->Fit(light->Position, light->Radius, sceneData->GetBoundingHypersphere());
+		fillShadowGrid		= shadowGrid->IsValid;
+		shadowGrid->IsDirty	= false;
+	}
+
+	// Runs before the march, which reads the bricks once they are complete. Frames keep coming until then, see Application::GetFrameInvalidation.
+	const bool updateVoxelGrid		= voxelGrid->IsEnabled && voxelGrid->IsDirty;
+	const int launchedBrickCount	= updateVoxelGrid ? UpdateVoxelGrid(voxelGrid, sceneData) : 0;
+
+	// The G-buffer survives between frames, so shading-only changes skip the march stage and light-only changes only redo the shadows.
+	if (invalidation >= RenderInvalidation::Geometry)
+	{
+		// With variable rate, only the block anchors are marched here. The blocks between them are interpolated if uniform and marched otherwise.
+		// Progressive frames march at a coarser rate than that and fill the gaps from the anchors, until a later frame refines them.
+		marchPixelKernel KERNEL_ARGS2(numBlocksMarch, threadsPerBlock)(bufferData, sceneData, config, camera);
+		if (marchRateShift > variableRateShift)
+		{
+			k_FillProgressive KERNEL_ARGS2(numBlocks, threadsPerBlock)(bufferData);
+		}
+		else if (marchRate > 1)
+		{
+			const MarchPixelKernel_t refineVariableRateKernel = GetMarchPixelKernel(primaryProjection, secondaryProjection, hitAttributes, MarchKernelType::RefineVariableRate);
+			refineVariableRateKernel KERNEL_ARGS2(numBlocks, threadsPerBlock)(bufferData, sceneData, config, camera);
+		}
+	}
+	if (computeAmbientOcclusion)
+	{
+		// Refines the ambient occlusion in the G-buffer. Also runs in frames that only reshade, until enough frames are accumulated.
+		k_AmbientOcclusionPixel KERNEL_ARGS2(numBlocks, threadsPerBlock)(bufferData, sceneData, config);
+	}
+	if (invalidation >= RenderInvalidation::Lighting && castKeyLightShadows && useStochasticShadows)
+	{
+		// Accumulates into the shadow history. Always at full rate, as each pixel needs its own history.
+		k_StochasticShadowPixel KERNEL_ARGS2(numBlocks, threadsPerBlock)(bufferData, sceneData, config, light, previousShadowCamera);
+		castStochasticShadows = true;
+	}
+	else if (invalidation >= RenderInvalidation::Lighting && castKeyLightShadows)
+	{
+		if (fillShadowGrid)
+		{
+			constexpr unsigned int FILL_BLOCK_SIZE = 256;
+			k_FillShadowGrid KERNEL_ARGS2((RenderShadowGridDataCUDA::CELL_COUNT + FILL_BLOCK_SIZE - 1) / FILL_BLOCK_SIZE, FILL_BLOCK_SIZE)(shadowGrid, sceneData, config, light);
+		}
+
+		// Shadows are low frequency, so at reduced rates only every n-th pixel casts a shadow ray and the rest is filled in by an edge aware upsample.
+		k_ShadowPixel KERNEL_ARGS2(numBlocksShadow, threadsPerBlock)(bufferData, sceneData, config, light, shadowGrid);
+		if (shadowRate > 1)
+		{
+			k_UpsampleShadows KERNEL_ARGS2(numBlocks, threadsPerBlock)(bufferData, sceneData, config, light, shadowGrid);
+		}
+	}
+	if (invalidation >= RenderInvalidation::Lighting && requiresShadows)
+	{
+		// Runs once the key light is final, as the upsample and the stochastic history only know about the key light.
+		k_AdditionalLightsPixel KERNEL_ARGS2(numBlocks, threadsPerBlock)(bufferData, sceneData, config, lights);
+	}
+	k_ShadePixel KERNEL_ARGS2(numBlocks, threadsPerBlock)(bufferData, config, camera);
+	if (useEdgeSupersampling && antiAliasingFrame <= 1)
+	{
+		// Only the pixels on edges march extra birays. They are compacted into a list first, so that the supersampling warps stay busy.
+		constexpr unsigned int SUPERSAMPLE_BLOCK_COUNT	= 256;
+		constexpr unsigned int SUPERSAMPLE_BLOCK_SIZE	= 64;
+		const MarchPixelKernel_t supersampleEdgesKernel	= GetMarchPixelKernel(primaryProjection, secondaryProjection, hitAttributes, MarchKernelType::SupersampleEdges);
+
+		CUDA_CHECK_ERROR(cudaMemset(d_edgePixelCount, 0, sizeof(unsigned int)));
+		k_DetectEdges KERNEL_ARGS2(numBlocks, threadsPerBlock)(bufferData, config, camera);
+		supersampleEdgesKernel KERNEL_ARGS2(SUPERSAMPLE_BLOCK_COUNT, SUPERSAMPLE_BLOCK_SIZE)(bufferData, sceneData, config, camera);
+	}
+	if (antiAliasingFrame > 0)
+	{
+		// Only while nothing changes. Later frames take the edge supersampling from the history.
+		const MarchPixelKernel_t accumulateAntiAliasingKernel = GetMarchPixelKernel(primaryProjection, secondaryProjection, hitAttributes, MarchKernelType::AccumulateAntiAliasing);
+		accumulateAntiAliasingKernel KERNEL_ARGS2(numBlocks, threadsPerBlock)(bufferData, sceneData, config, camera);
+	}
+	k_PresentViewAtlas KERNEL_ARGS2(numBlocksPresent, threadsPerBlock)(bufferData);
 	
 	cudaDeviceSynchronize();
 	CUDA_CHECK_ERROR(cudaGetLastError());
+
+	if (updateVoxelGrid)
+	{
+		CompleteVoxelGridUpdate(voxelGrid, launchedBrickCount);
+	}
+	if (castStochasticShadows)
+	{
+		// The next frame reprojects into the history that was just written.
+		*previousShadowCamera = *camera;
+	}
 	
 	////////////////////////////////////////////////////////////////
 
@@ -116,69 +350,54 @@ void CUDA_RenderImage(RenderPixelBufferDataCUDA* bufferData, RenderSceneDataCUDA
 
 ////////////////////////////////////////////////////////////////
 
-A_CUDA_KERNEL void k_RenderPixel(RenderPixelBufferDataCUDA* bufferData, RenderSceneDataCUDA* sceneData, Configuration* config, Camera<glm::vec4>* camera, Light<glm::vec4>* light)
+// Maps the current thread to a pixel of the view atlas. Returns false if the thread lies outside of its view.
+// With a stride shift, each thread maps to every (1 << strideShift)-th pixel per axis.
+A_CUDA_GPU bool GetAtlasPixel(const RenderPixelBufferDataCUDA* bufferData, int& outViewID, int& outAtlasX, int& outAtlasY, const unsigned int strideShift = 0)
 {
-	#define USE_BIRAY_MARCHING
-
-	// Global
+	outViewID	= blockIdx.z;
+	outAtlasX	= (blockIdx.x * blockDim.x + threadIdx.x) << strideShift;
+	outAtlasY	= (blockIdx.y * blockDim.y + threadIdx.y) << strideShift;
 
-	const int pixelX		= blockIdx.x * blockDim.x + threadIdx.x;
-	const int pixelY		= blockIdx.y * blockDim.y + threadIdx.y;
-	
-	const int viewX			= pixelX / bufferData->ViewDimensions.x; 
-	const int viewY			= pixelY / bufferData->ViewDimensions.y;
-	const int viewID		= viewY * bufferData->NumViews.x + viewX;
-	const int viewCount		= bufferData->NumViews.x * bufferData->NumViews.y;
-
-	const int viewOriginX	= viewX * bufferData->ViewDimensions.x;
-	const int viewOriginY	= viewY * bufferData->ViewDimensions.y;
+	const ViewQualityData& viewQuality = bufferData->ViewQualities[outViewID];
+	return outAtlasX < viewQuality.AtlasDimensions.x && outAtlasY < viewQuality.AtlasDimensions.y;
+}
 
-	const float viewPercentage	= (viewCount == 1) ? 0.5f : viewID / static_cast<float>(viewCount);
+////////////////////////////////////////////////////////////////
 
-	// In View
+// Marches a single sample of a view. Pixels cover the scene inside of the scissor rect or nothing.
+template <ProjectionMethod PRIMARY, ProjectionMethod SECONDARY, unsigned int HIT_ATTRIBUTES>
+A_CUDA_GPU RayMarchResult<glm::vec4> MarchViewSample(RenderSceneDataCUDA* sceneData, Configuration* config, Camera<glm::vec4>* camera, const ViewQualityData& viewQuality, const float viewPercentage, 
+	const float inViewPercentageX, const float inViewPercentageY)
+{
+	#define USE_BIRAY_MARCHING
 
-	const int inViewX		= pixelX - viewOriginX;
-	const int inViewY		= pixelY - viewOriginY;
-	
-	// Ray
-	const float inViewPercentageX = inViewX / static_cast<float>(bufferData->ViewDimensions.x);
-	const float inViewPercentageY = inViewY / static_cast<float>(bufferData->ViewDimensions.y);
-	
 	constexpr float SCISSOR_RECT_SIZE_X			= 0.40f;
 	constexpr float SCISSOR_RECT_SIZE_X_HALF	= SCISSOR_RECT_SIZE_X / 2.0f;
 	constexpr float SCISSOR_RECT_SIZE_Y			= 0.60f;
 	constexpr float SCISSOR_RECT_SIZE_Y_HALF	= SCISSOR_RECT_SIZE_Y / 2.0f;
-	constexpr float GROUND_PLANE_Y				= 0.0f;
 
-	const bool isInGroundPlane = inViewPercentageY < GROUND_PLANE_Y;
 	const bool isInScissorRect = inViewPercentageX > (0.5f - SCISSOR_RECT_SIZE_X_HALF) && inViewPercentageX < (0.5f + SCISSOR_RECT_SIZE_X_HALF) &&
 		 				   inViewPercentageY > (0.5f - SCISSOR_RECT_SIZE_Y_HALF) && inViewPercentageY < (0.5f + SCISSOR_RECT_SIZE_Y_HALF);
 	
 	// March Ray
 
 	RayMarchResult<glm::vec4> result;
-	if (isInGroundPlane)
-	{
-		// Render Ground Plane via Raytracing
-
-		// Calculate intersection point between ray and plane. Note: We do only use a ray here, not a biray.
-		glm::highp_mat4 biRaySpaceToWorldSpace;
-		const Math::BiRay<glm::vec4> biRay	= camera->GetBiray(viewPercentage, inViewPercentageX, inViewPercentageY, biRaySpaceToWorldSpace);
-
-		constexpr float GROUND_POSITION_Y	= -100.0f;
-		const float traversedMain			= GROUND_POSITION_Y - biRay.Origin.y / biRay.DirectionMain.y;
-		const glm::vec4 position			= biRay.At(traversedMain, 0);
-		const glm::vec4 normal				= glm::vec4(0, 1, 0, 0);
-
-		result = RayMarchResult<glm::vec4>(true, traversedMain, 1, 0, 0, position, position, position, normal, normal);
-	}
-	else if (isInScissorRect)
+	if (isInScissorRect)
 	{
 		// Render Scene	via WaveMarching	
 
+		const unsigned int maxSteps			= static_cast<unsigned int>(config->MAX_STEPS * viewQuality.MaxStepsFactor);
+
 		glm::highp_mat4 biRaySpaceToWorldSpace;
-		const Math::BiRay<glm::vec4> biRay	= camera->GetBiray(viewPercentage, inViewPercentageX, inViewPercentageY, biRaySpaceToWorldSpace);
-		result								= RayMarchFunctions::MarchSingleBiRay<glm::vec4, glm::mat4>(biRay, biRaySpaceToWorldSpace, sceneData, config->MIN_STEP_SIZE, config->MAX_DEPTH, config->MAX_STEPS, config->RAY_HIT_EPSILON);
+		const Math::BiRay<glm::vec4> biRay	= camera->GetBiray<PRIMARY, SECONDARY>(viewPercentage, inViewPercentageX, inViewPercentageY, biRaySpaceToWorldSpace);
+		if (config->UseAnalyticIntersection && sceneData->IsAnalytic())
+		{
+			result							= RayMarchFunctions::IntersectSingleBiRay<HIT_ATTRIBUTES>(biRay, sceneData, config->MAX_DEPTH);
+		}
+		else
+		{
+			result							= RayMarchFunctions::MarchSingleBiRay<glm::vec4, glm::mat4, HIT_ATTRIBUTES>(biRay, biRaySpaceToWorldSpace, sceneData, config->MIN_STEP_SIZE, config->MAX_DEPTH, maxSteps, config->RAY_HIT_EPSILON);
+		}
 	}
 	else
 	{
@@ -187,19 +406,1015 @@ A_CUDA_KERNEL void k_RenderPixel(RenderPixelBufferDataCUDA* bufferData, RenderSc
 		result.Hit = false;
 	}
 
-	// Soft shadows
-	if (result.Hit)
+	return result;
+}
+
+////////////////////////////////////////////////////////////////
+
+template <ProjectionMethod PRIMARY, ProjectionMethod SECONDARY, unsigned int HIT_ATTRIBUTES>
+A_CUDA_KERNEL void k_MarchPixel(RenderPixelBufferDataCUDA* bufferData, RenderSceneDataCUDA* sceneData, Configuration* config, Camera<glm::vec4>* camera)
+{
+	// Global
+
+	int viewID, atlasX, atlasY;
+	if (!GetAtlasPixel(bufferData, viewID, atlasX, atlasY, bufferData->MarchRateShift))
+	{
+		return;
+	}
+
+	// Pixels on the grid of the previous progressive pass are already marched.
+	const int previousPassMask = (2 << bufferData->MarchRateShift) - 1;
+	if (bufferData->IsProgressiveRefinement && (atlasX & previousPassMask) == 0 && (atlasY & previousPassMask) == 0)
+	{
+		return;
+	}
+
+	const int viewCount		= bufferData->ViewCount;
+	const ViewQualityData& viewQuality = bufferData->ViewQualities[viewID];
+
+	const float viewPercentage	= GetViewPercentage(viewID, viewCount);
+
+	// In View
+
+	const int inViewX		= atlasX << viewQuality.ResolutionShift;
+	const int inViewY		= atlasY << viewQuality.ResolutionShift;
+	
+	// Ray
+	const float inViewPercentageX = inViewX / static_cast<float>(bufferData->ViewDimensions.x);
+	const float inViewPercentageY = inViewY / static_cast<float>(bufferData->ViewDimensions.y);
+
+	RayMarchResult<glm::vec4> result = MarchViewSample<PRIMARY, SECONDARY, HIT_ATTRIBUTES>(sceneData, config, camera, viewQuality, viewPercentage, inViewPercentageX, inViewPercentageY);
+
+	// Unshadowed until the shadow pass runs, which it does not for draw modes that ignore shadows.
+	result.ShadowValue = 1.0f;
+
+	bufferData->d_GBuffer[bufferData->GetAtlasIndex(viewID, atlasX, atlasY)] = PackedRayMarchResult(result, camera->ViewPaneDistance);
+}
+
+////////////////////////////////////////////////////////////////
+
+// Soft shadow value of a point, marched towards the light.
+A_CUDA_GPU float MarchShadowValue(const glm::vec4& position, RenderSceneDataCUDA* sceneData, Configuration* config, const Light<glm::vec4>* light)
+{
+	const glm::vec4 toLightPosition		= light->Position - position;
+	const float toLightDistance			= glm::length(toLightPosition);
+	const glm::vec4 toLightPositionN	= toLightPosition / toLightDistance;
+
+	const Math::Ray<glm::vec4> shadowRay = Math::Ray<glm::vec4>(position + toLightPositionN * config->SHADOW_START_OFFSET, toLightPositionN);
+	return RayMarchFunctions::MarchSecondaryShadowRay<glm::vec4>(shadowRay, sceneData, toLightDistance, light->Radius, config->MAX_STEPS_SHADOW, config->RAY_HIT_EPSILON, config->SHADOW_PENUMBRA);
+}
+
+////////////////////////////////////////////////////////////////
+
+A_CUDA_KERNEL void k_FillShadowGrid(RenderShadowGridDataCUDA* shadowGrid, RenderSceneDataCUDA* sceneData, Configuration* config, Light<glm::vec4>* light)
+{
+	const int cellIndex = blockIdx.x * blockDim.x + threadIdx.x;
+	if (cellIndex >= RenderShadowGridDataCUDA::CELL_COUNT)
+	{
+		return;
+	}
+
+	const glm::vec4 position = shadowGrid->GetCellPosition(cellIndex);
+	if (sceneData->EvaluateDistance(position) < 0.0f)
+	{
+		shadowGrid->d_Visibility[cellIndex] = RenderShadowGridDataCUDA::UNKNOWN_VISIBILITY;
+		return;
+	}
+
+	shadowGrid->d_Visibility[cellIndex] = MarchShadowValue(position, sceneData, config, light);
+}
+
+////////////////////////////////////////////////////////////////
+
+A_CUDA_KERNEL void k_ClassifyVoxelBricks(RenderVoxelBufferDataCUDA* voxelGrid, RenderSceneDataCUDA* sceneData)
+{
+	const int cellIndex = blockIdx.x * blockDim.x + threadIdx.x;
+	if (cellIndex >= RenderVoxelBufferDataCUDA::CELL_COUNT)
+	{
+		return;
+	}
+
+	const float distance					= sceneData->EvaluateCachedDistance(voxelGrid->GetCellCenter(cellIndex));
+	voxelGrid->mcm_CellDistances[cellIndex]	= distance;
+	if (Math::Abs(distance) >= voxelGrid->GetNarrowBandDistance())
+	{
+		voxelGrid->mcm_BrickTable[cellIndex] = RenderVoxelBufferDataCUDA::NO_BRICK;
+		return;
+	}
+
+	const int brickIndex = atomicAdd(&voxelGrid->mcm_BrickCells[RenderVoxelBufferDataCUDA::MAX_BRICKS], 1);
+	if (brickIndex >= RenderVoxelBufferDataCUDA::MAX_BRICKS)
+	{
+		voxelGrid->mcm_BrickTable[cellIndex] = RenderVoxelBufferDataCUDA::OVERFLOW_BRICK;
+		return;
+	}
+
+	voxelGrid->mcm_BrickTable[cellIndex]	= brickIndex;
+	voxelGrid->mcm_BrickCells[brickIndex]	= cellIndex;
+}
+
+////////////////////////////////////////////////////////////////
+
+A_CUDA_KERNEL void k_FillVoxelBricks(RenderVoxelBufferDataCUDA* voxelGrid, RenderSceneDataCUDA* sceneData, const int firstBrick, const int brickCount)
+{
+	const int index = blockIdx.x * blockDim.x + threadIdx.x;
+	if (index >= brickCount * RenderVoxelDataCUDA::SAMPLE_COUNT)
+	{
+		return;
+	}
+
+	const int brickIndex	= firstBrick + index / RenderVoxelDataCUDA::SAMPLE_COUNT;
+	const int sampleIndex	= index % RenderVoxelDataCUDA::SAMPLE_COUNT;
+	voxelGrid->mcm_VolumeBuffer[brickIndex].Distances[sampleIndex] = sceneData->EvaluateCachedDistance(voxelGrid->GetSamplePosition(brickIndex, sampleIndex));
+}
+
+////////////////////////////////////////////////////////////////
+
+// Shadow value of a primary hit of the given view, for the cases that do not need a shadow ray. Returns false if one needs to be marched.
+A_CUDA_GPU bool TryGetUnmarchedShadowValue(const RenderPixelBufferDataCUDA* bufferData, const int viewID, const glm::vec4& position, Light<glm::vec4>* light, RenderShadowGridDataCUDA* shadowGrid, float& outShadowValue)
+{
+	if (!bufferData->ViewQualities[viewID].ShadowsEnabled)
+	{
+		// Lit as if nothing was in between, which matches the light intensity of an unoccluded shadow ray.
+		outShadowValue = Math::Clamp01(light->Radius / glm::length(light->Position - position));
+		return true;
+	}
+
+	// The grid does not reach everywhere, e.g. the ground plane still needs a shadow ray.
+	return shadowGrid->IsEnabled && shadowGrid->SampleVisibility(position, outShadowValue);
+}
+
+////////////////////////////////////////////////////////////////
+
+// Soft shadow value of a primary hit of the given view.
+A_CUDA_GPU float ComputeShadowValue(const RenderPixelBufferDataCUDA* bufferData, const int viewID, const glm::vec4& position, RenderSceneDataCUDA* sceneData, Configuration* config, Light<glm::vec4>* light, RenderShadowGridDataCUDA* shadowGrid)
+{
+	float shadowValue;
+	if (TryGetUnmarchedShadowValue(bufferData, viewID, position, light, shadowGrid, shadowValue))
+	{
+		return shadowValue;
+	}
+
+	return MarchShadowValue(position, sceneData, config, light);
+}
+
+////////////////////////////////////////////////////////////////
+// Shadow Ray Packets
+////////////////////////////////////////////////////////////////
+
+constexpr unsigned int FULL_WARP_MASK = 0xffffffff;
+
+A_CUDA_GPU float WarpSum(float value)
+{
+	for (int offset = 16; offset > 0; offset >>= 1)
+	{
+		value += __shfl_xor_sync(FULL_WARP_MASK, value, offset);
+	}
+	return value;
+}
+
+A_CUDA_GPU float WarpMin(float value)
+{
+	for (int offset = 16; offset > 0; offset >>= 1)
+	{
+		value = fminf(value, __shfl_xor_sync(FULL_WARP_MASK, value, offset));
+	}
+	return value;
+}
+
+A_CUDA_GPU float WarpMax(float value)
+{
+	for (int offset = 16; offset > 0; offset >>= 1)
+	{
+		value = fmaxf(value, __shfl_xor_sync(FULL_WARP_MASK, value, offset));
+	}
+	return value;
+}
+
+////////////////////////////////////////////////////////////////
+
+// Marches the shadow rays of a warp as a packet. All rays end at the light and neighbouring pixels have nearly parallel rays,
+// so together they lie inside of a thin cone with its apex at the light. 
+// 1) The warp cone marches from the light towards the surfaces. Every step is one SDF evaluation shared by all lanes and proves a slab of the cone empty.
+//    Each lane also takes a lower bound of its penumbra from these steps.
+// 2) Each lane marches its own ray, but only up to the empty part of the cone.
+// Falls back to independent rays if the warp has too few rays or the cone is too wide.
+// Needs to be called by every thread of a full warp, isActive masks out threads without a shadow ray. The launch has to guarantee full warps.
+A_CUDA_GPU float MarchShadowPacket(const bool isActive, const glm::vec4& position, RenderSceneDataCUDA* sceneData, Configuration* config, Light<glm::vec4>* light)
+{
+	constexpr int MIN_PACKET_RAYS			= 8;
+	constexpr float MAX_PACKET_CONE_TAN		= 0.1f;
+	constexpr int MAX_PACKET_STEPS			= 64;
+
+	const glm::vec4 lightPosition	= light->Position;
+	const float toLightDistance		= glm::length(lightPosition - position);
+
+	float freeDistance				= 0.0f;		// < Distance from the light up to which the cone is proven empty.
+	float packetPenumbra			= 1.0f;
+
+	// With independent thread scheduling, the lanes need not have reconverged after the divergent code of the caller. __activemask would only
+	// report the lanes that happen to be here, so we wait for the whole warp instead.
+	__syncwarp(FULL_WARP_MASK);
+	if (__popc(__ballot_sync(FULL_WARP_MASK, isActive)) >= MIN_PACKET_RAYS)
+	{
+		const float activeCount		= WarpSum(isActive ? 1.0f : 0.0f);
+		const glm::vec4 fromLight	= position - lightPosition;
+		const glm::vec4 centroid	= glm::vec4(
+			WarpSum(isActive ? fromLight.x : 0.0f), 
+			WarpSum(isActive ? fromLight.y : 0.0f), 
+			WarpSum(isActive ? fromLight.z : 0.0f), 
+			WarpSum(isActive ? fromLight.w : 0.0f)) / activeCount;
+		const glm::vec4 axis		= glm::normalize(centroid);
+
+		// Cone angle and the nearest ray start along the axis. The cone march must stop before it.
+		const float along			= glm::dot(fromLight, axis);
+		const float lateral			= glm::sqrt(Math::Max(glm::dot(fromLight, fromLight) - along * along, 0.0f));
+		const float coneTan			= WarpMax(isActive ? (along > 0.0f ? lateral / along : FLT_MAX) : 0.0f);
+		const float maxFreeDistance	= WarpMin(isActive ? along - config->SHADOW_START_OFFSET : FLT_MAX);
+
+		if (coneTan < MAX_PACKET_CONE_TAN)
+		{
+			for (int step = 0; step < MAX_PACKET_STEPS && freeDistance < maxFreeDistance; step++)
+			{
+				// Same sample for the whole warp
+				const float distance	= sceneData->EvaluateDistance(lightPosition + axis * freeDistance);
+				const float coneRadius	= freeDistance * coneTan;
+
+				// The ball around the sample covers the cone slab [freeDistance, freeDistance + stepSize].
+				const float stepSize	= (distance - coneRadius) / (1.0f + coneTan);
+				if (stepSize < config->RAY_HIT_EPSILON)
+				{
+					break;
+				}
+
+				// Every lane passes within coneRadius of the sample, so the scene is at least that much closer to its ray.
+				const float traversed	= Math::Max(toLightDistance - freeDistance, 0.0001f);
+				packetPenumbra			= Math::Min(packetPenumbra, config->SHADOW_PENUMBRA * (distance - coneRadius) / traversed);
+				freeDistance			= Math::Min(freeDistance + stepSize, maxFreeDistance);
+			}
+		}
+	}
+
+	if (!isActive)
+	{
+		return 1.0f;
+	}
+
+	const float intensity		= Math::Clamp01(light->Radius / toLightDistance);
+	const float remainingLength	= toLightDistance - freeDistance;
+	if (remainingLength <= config->SHADOW_START_OFFSET)
+	{
+		return packetPenumbra * intensity;
+	}
+
+	// Per lane march up to the empty part of the cone. The light radius is scaled, so that the intensity still matches the full ray length.
+	const glm::vec4 toLightN				= (lightPosition - position) / toLightDistance;
+	const Math::Ray<glm::vec4> shadowRay	= Math::Ray<glm::vec4>(position + toLightN * config->SHADOW_START_OFFSET, toLightN);
+	const float laneShadowValue				= RayMarchFunctions::MarchSecondaryShadowRay<glm::vec4>(shadowRay, sceneData, remainingLength, light->Radius * remainingLength / toLightDistance, config->MAX_STEPS_SHADOW, config->RAY_HIT_EPSILON, config->SHADOW_PENUMBRA);
+
+	return Math::Min(laneShadowValue, packetPenumbra * intensity);
+}
+
+////////////////////////////////////////////////////////////////
+
+// Computes the shadows of every (1 << ShadowRateShift)-th pixel per axis. These anchors are upsampled by k_UpsampleShadows.
+A_CUDA_KERNEL void k_ShadowPixel(RenderPixelBufferDataCUDA* bufferData, RenderSceneDataCUDA* sceneData, Configuration* config, Light<glm::vec4>* light, RenderShadowGridDataCUDA* shadowGrid)
+{
+	int viewID, atlasX, atlasY;
+	const bool isInView					= GetAtlasPixel(bufferData, viewID, atlasX, atlasY, bufferData->ShadowRateShift);
+	PackedRayMarchResult* gBuffer		= isInView ? &bufferData->d_GBuffer[bufferData->GetAtlasIndex(viewID, atlasX, atlasY)] : nullptr;
+	const bool isHit					= isInView && gBuffer->IsHit();
+	const glm::vec4 position			= isHit ? gBuffer->Position : light->Position;
+
+	// Soft shadows, starting at the cached primary hit
+	float shadowValue	= 1.0f;
+	const bool isMarch	= isHit && !TryGetUnmarchedShadowValue(bufferData, viewID, position, light, shadowGrid, shadowValue);
+
+	// No thread may leave early, the packet needs the whole warp.
+	static_assert((BLOCK_SIZE_2D * BLOCK_SIZE_2D) % 32 == 0, "Shadow ray packets need blocks of full warps.");
+	if (config->UseShadowRayPackets)
+	{
+		const float marchedShadowValue = MarchShadowPacket(isMarch, position, sceneData, config, light);
+		shadowValue = isMarch ? marchedShadowValue : shadowValue;
+	}
+	else if (isMarch)
+	{
+		shadowValue = MarchShadowValue(position, sceneData, config, light);
+	}
+
+	if (isHit)
+	{
+		gBuffer->SetShadowValue(shadowValue);
+	}
+}
+
+////////////////////////////////////////////////////////////////
+
+// Fills in the shadows between the anchors with a bilateral filter. Anchors on other surfaces are weighted down by position and normal.
+// If the remaining anchors disagree, the pixel lies on a shadow edge and casts its own shadow ray.
+A_CUDA_KERNEL void k_UpsampleShadows(RenderPixelBufferDataCUDA* bufferData, RenderSceneDataCUDA* sceneData, Configuration* config, Light<glm::vec4>* light, RenderShadowGridDataCUDA* shadowGrid)
+{
+	int viewID, atlasX, atlasY;
+	if (!GetAtlasPixel(bufferData, viewID, atlasX, atlasY))
 	{
-		const glm::vec4 toLightPosition		= light->Position - result.Position;
+		return;
+	}
+
+	const int rate			= 1 << bufferData->ShadowRateShift;
+	const int anchorMask	= rate - 1;
+	if ((atlasX & anchorMask) == 0 && (atlasY & anchorMask) == 0)
+	{
+		return;
+	}
+
+	PackedRayMarchResult& gBuffer = bufferData->d_GBuffer[bufferData->GetAtlasIndex(viewID, atlasX, atlasY)];
+	if (!gBuffer.IsHit())
+	{
+		return;
+	}
+
+	constexpr float POSITION_SIGMA			= 2.0f;		// < World space distance at which an anchor counts half.
+	constexpr float NORMAL_POWER			= 8.0f;
+	constexpr float MIN_ANCHOR_WEIGHT		= 0.01f;
+	constexpr float MAX_VISIBILITY_SPREAD	= 0.2f;
+
+	const ViewQualityData& viewQuality	= bufferData->ViewQualities[viewID];
+	const glm::vec4 normal				= gBuffer.GetNormal();
+	const bool hasNormal				= glm::dot(normal, normal) > 0.5f;		// < Draw modes without normals leave them zero.
+
+	const int anchorX0	= atlasX & ~anchorMask;
+	const int anchorY0	= atlasY & ~anchorMask;
+	const int anchorX1	= anchorX0 + rate < viewQuality.AtlasDimensions.x ? anchorX0 + rate : anchorX0;
+	const int anchorY1	= anchorY0 + rate < viewQuality.AtlasDimensions.y ? anchorY0 + rate : anchorY0;
+	const float tx		= (atlasX - anchorX0) / static_cast<float>(rate);
+	const float ty		= (atlasY - anchorY0) / static_cast<float>(rate);
+
+	const int anchorXs[4]		= {anchorX0, anchorX1, anchorX0, anchorX1};
+	const int anchorYs[4]		= {anchorY0, anchorY0, anchorY1, anchorY1};
+	const float bilinear[4]		= {(1.0f - tx) * (1.0f - ty), tx * (1.0f - ty), (1.0f - tx) * ty, tx * ty};
+
+	float weightedVisibility	= 0.0f;
+	float totalWeight			= 0.0f;
+	float minVisibility			= 1.0f;
+	float maxVisibility			= 0.0f;
+	for (int i = 0; i < 4; i++)
+	{
+		const PackedRayMarchResult& anchor = bufferData->d_GBuffer[bufferData->GetAtlasIndex(viewID, anchorXs[i], anchorYs[i])];
+		if (!anchor.IsHit())
+		{
+			continue;
+		}
+
+		const glm::vec4 offset		= anchor.Position - gBuffer.Position;
+		const float positionWeight	= 1.0f / (1.0f + glm::dot(offset, offset) / (POSITION_SIGMA * POSITION_SIGMA));
+		const float normalWeight	= hasNormal ? glm::pow(Math::Clamp01(glm::dot(normal, anchor.GetNormal())), NORMAL_POWER) : 1.0f;
+		const float weight			= (bilinear[i] + MIN_ANCHOR_WEIGHT) * positionWeight * normalWeight;
+		if (weight < MIN_ANCHOR_WEIGHT * MIN_ANCHOR_WEIGHT)
+		{
+			continue;
+		}
+
+		const float visibility	= anchor.GetShadowValue();
+		weightedVisibility		+= visibility * weight;
+		totalWeight				+= weight;
+		minVisibility			= Math::Min(minVisibility, visibility);
+		maxVisibility			= Math::Max(maxVisibility, visibility);
+	}
+
+	const bool anchorsAgree = totalWeight > 0.0f && maxVisibility - minVisibility < MAX_VISIBILITY_SPREAD;
+	gBuffer.SetShadowValue(anchorsAgree ? weightedVisibility / totalWeight : ComputeShadowValue(bufferData, viewID, gBuffer.Position, sceneData, config, light, shadowGrid));
+}
+
+////////////////////////////////////////////////////////////////
+
+// PCG hash, decorrelates the stochastic samples per pixel and frame.
+A_CUDA_GPU unsigned int HashPCG(const unsigned int value)
+{
+	const unsigned int state	= value * 747796405u + 2891336453u;
+	const unsigned int word		= ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+	return (word >> 22u) ^ word;
+}
+
+////////////////////////////////////////////////////////////////
+
+A_CUDA_GPU float NextRandom01(unsigned int& seed)
+{
+	seed = HashPCG(seed);
+	return (seed >> 8) * (1.0f / 16777216.0f);
+}
+
+////////////////////////////////////////////////////////////////
+
+// Uniformly distributed point inside of the unit hyperball.
+A_CUDA_GPU glm::vec4 SampleUnitHyperball(unsigned int& seed)
+{
+	// Normalized gaussian samples are uniform on the hypersphere. Box-Muller yields two of them per pair of uniform samples.
+	float gaussians[4];
+	for (int i = 0; i < 4; i += 2)
+	{
+		const float radius	= sqrtf(-2.0f * logf(Math::Max(NextRandom01(seed), 0.0000001f)));
+		const float angle	= glm::two_pi<float>() * NextRandom01(seed);
+		gaussians[i]		= radius * cosf(angle);
+		gaussians[i + 1]	= radius * sinf(angle);
+	}
+
+	const glm::vec4 direction = glm::normalize(glm::vec4(gaussians[0], gaussians[1], gaussians[2], gaussians[3]));
+
+	// The volume of a 4-ball grows with r^4.
+	return direction * sqrtf(sqrtf(NextRandom01(seed)));
+}
+
+////////////////////////////////////////////////////////////////
+
+// Area light shadows: hard shadow rays towards random points of the light hypersphere, averaged over frames.
+// The history of the last frame is reprojected with the camera it was rendered with and rejected if it belongs to another surface.
+A_CUDA_KERNEL void k_StochasticShadowPixel(RenderPixelBufferDataCUDA* bufferData, RenderSceneDataCUDA* sceneData, Configuration* config, Light<glm::vec4>* light, Camera<glm::vec4>* previousShadowCamera)
+{
+	int viewID, atlasX, atlasY;
+	if (!GetAtlasPixel(bufferData, viewID, atlasX, atlasY))
+	{
+		return;
+	}
+
+	const unsigned int atlasIndex		= bufferData->GetAtlasIndex(viewID, atlasX, atlasY);
+	PackedRayMarchResult& gBuffer		= bufferData->d_GBuffer[atlasIndex];
+	ShadowHistorySample& history		= bufferData->d_ShadowHistory[atlasIndex];
+	const ViewQualityData& viewQuality	= bufferData->ViewQualities[viewID];
+
+	history.SampleCount = 0.0f;
+	if (!gBuffer.IsHit())
+	{
+		return;
+	}
+
+	if (!viewQuality.ShadowsEnabled)
+	{
+		gBuffer.SetShadowValue(Math::Clamp01(light->Radius / glm::length(light->Position - gBuffer.Position)));
+		return;
+	}
+
+	// Reproject
+	constexpr float MAX_HISTORY_DISTANCE = 0.5f;
+
+	ShadowHistorySample previous;
+	float previousInViewPercentageX, previousInViewPercentageY;
+	if (!bufferData->ResetShadowHistory && previousShadowCamera->ProjectToView(gBuffer.Position, GetViewPercentage(viewID, bufferData->ViewCount), previousInViewPercentageX, previousInViewPercentageY))
+	{
+		const float toAtlas		= 1.0f / static_cast<float>(1 << viewQuality.ResolutionShift);
+		const int previousX		= static_cast<int>(previousInViewPercentageX * bufferData->ViewDimensions.x * toAtlas + 0.5f);
+		const int previousY		= static_cast<int>(previousInViewPercentageY * bufferData->ViewDimensions.y * toAtlas + 0.5f);
+		if (previousX < viewQuality.AtlasDimensions.x && previousY < viewQuality.AtlasDimensions.y)
+		{
+			const ShadowHistorySample& candidate = bufferData->d_PreviousShadowHistory[bufferData->GetAtlasIndex(viewID, previousX, previousY)];
+			if (candidate.SampleCount > 0.0f && glm::length(candidate.Position - gBuffer.Position) < MAX_HISTORY_DISTANCE)
+			{
+				previous = candidate;
+			}
+		}
+	}
+
+	// New samples
+	// A huge penumbra factor turns the soft shadow march into a hard visibility test.
+	constexpr float HARD_SHADOW_PENUMBRA = 1000000.0f;
+
+	unsigned int seed				= HashPCG(atlasIndex ^ HashPCG(bufferData->ShadowFrameIndex));
+	const int samplesPerFrame		= config->StochasticShadowSamplesPerFrame;
+	float frameVisibility			= 0.0f;
+	for (int i = 0; i < samplesPerFrame; i++)
+	{
+		const glm::vec4 lightSample			= light->Position + SampleUnitHyperball(seed) * light->AreaRadius;
+		const glm::vec4 toLightPosition		= lightSample - gBuffer.Position;
 		const float toLightDistance			= glm::length(toLightPosition);
 		const glm::vec4 toLightPositionN	= toLightPosition / toLightDistance;
 
-		// Shadow Ray
-		const Math::Ray<glm::vec4> shadowRay = Math::Ray<glm::vec4>(result.Position + toLightPositionN * config->SHADOW_START_OFFSET, toLightPositionN);
-		result.ShadowValue					 = RayMarchFunctions::MarchSecondaryShadowRay<glm::vec4>(shadowRay, sceneData, toLightDistance, light->Radius, config->MAX_STEPS_SHADOW, config->RAY_HIT_EPSILON, config->SHADOW_PENUMBRA);
+		const Math::Ray<glm::vec4> shadowRay = Math::Ray<glm::vec4>(gBuffer.Position + toLightPositionN * config->SHADOW_START_OFFSET, toLightPositionN);
+		frameVisibility += RayMarchFunctions::MarchSecondaryShadowRay<glm::vec4>(shadowRay, sceneData, toLightDistance, light->Radius, config->MAX_STEPS_SHADOW, config->RAY_HIT_EPSILON, HARD_SHADOW_PENUMBRA);
+	}
+	frameVisibility /= samplesPerFrame;
+
+	// Running mean, which becomes an exponential average once the sample limit is reached.
+	const float sampleCount	= Math::Min(previous.SampleCount + samplesPerFrame, static_cast<float>(config->StochasticShadowMaxSamples));
+	const float visibility	= previous.Visibility + (frameVisibility - previous.Visibility) * (samplesPerFrame / sampleCount);
+
+	history.Position	= gBuffer.Position;
+	history.Visibility	= visibility;
+	history.SampleCount	= sampleCount;
+	gBuffer.SetShadowValue(visibility);
+}
+
+////////////////////////////////////////////////////////////////
+
+// Adds the lights after the key light to the light amount of each hit. Lights with a negligible contribution at the hit are culled.
+// The others are visited by importance and get a shadow ray while the per pixel budget lasts, the remaining ones are added unshadowed.
+// So the cost of a frame grows with the budget and not with the light count.
+A_CUDA_KERNEL void k_AdditionalLightsPixel(RenderPixelBufferDataCUDA* bufferData, RenderSceneDataCUDA* sceneData, Configuration* config, LightList<glm::vec4>* lights)
+{
+	int viewID, atlasX, atlasY;
+	if (!GetAtlasPixel(bufferData, viewID, atlasX, atlasY))
+	{
+		return;
+	}
+
+	PackedRayMarchResult& gBuffer = bufferData->d_GBuffer[bufferData->GetAtlasIndex(viewID, atlasX, atlasY)];
+	if (!gBuffer.IsHit())
+	{
+		return;
+	}
+
+	const glm::vec4 position			= gBuffer.Position;
+	const Light<glm::vec4>& keyLight	= lights->GetKeyLight();
+
+	// The shadow passes before only ran for a shadow casting key light, which then takes one ray of the budget.
+	float lightAmount			= keyLight.CastsShadows ? gBuffer.GetShadowValue() * keyLight.Intensity : keyLight.GetImportance(position);
+	int remainingShadowRays		= bufferData->ViewQualities[viewID].ShadowsEnabled ? config->ShadowRayBudget - (keyLight.CastsShadows ? 1 : 0) : 0;
+
+	float importances[LightList<glm::vec4>::MAX_LIGHT_COUNT];
+	for (int i = 1; i < lights->LightCount; i++)
+	{
+		importances[i] = lights->Lights[i].GetImportance(position);
+	}
+
+	// There are only a few lights, so repeatedly picking the most important one is cheaper than sorting them.
+	for (int pass = 1; pass < lights->LightCount; pass++)
+	{
+		int lightIndex			= -1;
+		float importance		= config->LIGHT_CULL_IMPORTANCE;
+		for (int i = 1; i < lights->LightCount; i++)
+		{
+			if (importances[i] > importance)
+			{
+				lightIndex	= i;
+				importance	= importances[i];
+			}
+		}
+
+		if (lightIndex < 0)
+		{
+			// All remaining lights are culled.
+			break;
+		}
+		importances[lightIndex] = 0.0f;
+
+		const Light<glm::vec4>& light = lights->Lights[lightIndex];
+		if (light.CastsShadows && remainingShadowRays > 0)
+		{
+			lightAmount += MarchShadowValue(position, sceneData, config, &light) * light.Intensity;
+			remainingShadowRays--;
+		}
+		else
+		{
+			lightAmount += importance;
+		}
+	}
+
+	gBuffer.SetShadowValue(lightAmount);
+}
+
+////////////////////////////////////////////////////////////////
+
+// SDF ambient occlusion: the scene distance at a few taps along the normal is compared to the tap distance, nearby geometry occludes.
+// The first frame after a march taps along the normal itself. Later frames jitter the taps inside of a cone around it and are averaged in.
+A_CUDA_KERNEL void k_AmbientOcclusionPixel(RenderPixelBufferDataCUDA* bufferData, RenderSceneDataCUDA* sceneData, Configuration* config)
+{
+	int viewID, atlasX, atlasY;
+	if (!GetAtlasPixel(bufferData, viewID, atlasX, atlasY))
+	{
+		return;
+	}
+
+	const unsigned int atlasIndex	= bufferData->GetAtlasIndex(viewID, atlasX, atlasY);
+	PackedRayMarchResult& gBuffer	= bufferData->d_GBuffer[atlasIndex];
+	const glm::vec4 normal			= gBuffer.GetNormal();
+	if (!gBuffer.IsHit() || glm::dot(normal, normal) < 0.5f)
+	{
+		return;
+	}
+
+	constexpr float TAP_WEIGHT_FALLOFF = 0.5f;		// < Near taps matter most, far taps only add the large scale occlusion.
+
+	const unsigned int frame	= bufferData->AmbientOcclusionFrame;
+	unsigned int seed			= HashPCG(atlasIndex ^ HashPCG(frame));
+	const glm::vec4 direction	= frame > 0 ? glm::normalize(normal + SampleUnitHyperball(seed) * config->AMBIENT_OCCLUSION_CONE_TAN) : normal;
+	const float tapOffset		= frame > 0 ? 0.5f + 0.5f * NextRandom01(seed) : 1.0f;
+
+	float occlusion		= 0.0f;
+	float totalWeight	= 0.0f;
+	float weight		= 1.0f;
+	for (int i = 0; i < config->AMBIENT_OCCLUSION_TAP_COUNT; i++)
+	{
+		const float tapDistance	= (i + tapOffset) * config->AMBIENT_OCCLUSION_TAP_SPACING;
+		const float distance	= sceneData->EvaluateDistance(gBuffer.Position + direction * tapDistance);
+		occlusion				+= weight * Math::Clamp01((tapDistance - distance) / tapDistance);
+		totalWeight				+= weight;
+		weight					*= TAP_WEIGHT_FALLOFF;
+	}
+	const float ambientOcclusion = 1.0f - occlusion / totalWeight;
+
+	// Running mean over the frames since the last march
+	const float previous = frame > 0 ? gBuffer.GetAmbientOcclusion() : ambientOcclusion;
+	gBuffer.SetAmbientOcclusion(previous + (ambientOcclusion - previous) / static_cast<float>(frame + 1));
+}
+
+////////////////////////////////////////////////////////////////
+
+A_CUDA_KERNEL void k_ShadePixel(RenderPixelBufferDataCUDA* bufferData, Configuration* config, Camera<glm::vec4>* camera)
+{
+	int viewID, atlasX, atlasY;
+	if (!GetAtlasPixel(bufferData, viewID, atlasX, atlasY))
+	{
+		return;
+	}
+
+	const unsigned int atlasIndex			= bufferData->GetAtlasIndex(viewID, atlasX, atlasY);
+	const PackedRayMarchResult& gBuffer		= bufferData->d_GBuffer[atlasIndex];
+	RayMarchResult<glm::vec4> result		= gBuffer.ToRayMarchResult(camera->ViewPaneDistance);
+
+	// The G-buffer keeps the ambient occlusion of earlier frames, even if it was disabled since.
+	if (!config->UseAmbientOcclusion)
+	{
+		result.AmbientOcclusion = 1.0f;
 	}
 
 	// Color in
-	const uchar4 color = isInGroundPlane ? VisualizationHelper::GetColorForRayResult_SimpleLit(*config, result) : VisualizationHelper::GetColorForRayResult(*config, result);
+	bufferData->d_ViewAtlas[atlasIndex] = VisualizationHelper::GetColorForRayResult(*config, result);
+}
+
+////////////////////////////////////////////////////////////////
+// Edge Supersampling
+////////////////////////////////////////////////////////////////
+
+A_CUDA_GPU bool IsEdgeBetween(const PackedRayMarchResult& a, const PackedRayMarchResult& b, Configuration* config, const float depthReference)
+{
+	if (a.IsHit() != b.IsHit())
+	{
+		return true;
+	}
+	if (!a.IsHit())
+	{
+		return false;
+	}
+
+	// Depth jumps, relative to the depth, in both directions of the biray.
+	const float traversedPrimaryA	= a.GetTraversedPrimary(depthReference);
+	const float traversedPrimaryB	= b.GetTraversedPrimary(depthReference);
+	const float traversedSecondaryA	= a.GetTraversedSecondary();
+	const float traversedSecondaryB	= b.GetTraversedSecondary();
+	if (Math::Abs(traversedPrimaryA - traversedPrimaryB) > config->EDGE_DEPTH_THRESHOLD * Math::Max(Math::Abs(traversedPrimaryA), 1.0f) ||
+		Math::Abs(traversedSecondaryA - traversedSecondaryB) > config->EDGE_DEPTH_THRESHOLD * Math::Max(Math::Abs(traversedSecondaryA), 1.0f))
+	{
+		return true;
+	}
+
+	// Creases. Draw modes without normals leave them zero, which never counts as an edge.
+	const glm::vec4 normalA = a.GetNormal();
+	const glm::vec4 normalB = b.GetNormal();
+	return glm::dot(normalA, normalA) > 0.5f && glm::dot(normalB, normalB) > 0.5f && glm::dot(normalA, normalB) < config->EDGE_NORMAL_THRESHOLD;
+}
+
+////////////////////////////////////////////////////////////////
+
+// Appends every pixel that differs from one of its four neighbours to the edge list.
+A_CUDA_KERNEL void k_DetectEdges(RenderPixelBufferDataCUDA* bufferData, Configuration* config, Camera<glm::vec4>* camera)
+{
+	int viewID, atlasX, atlasY;
+	if (!GetAtlasPixel(bufferData, viewID, atlasX, atlasY))
+	{
+		return;
+	}
+
+	const ViewQualityData& viewQuality	= bufferData->ViewQualities[viewID];
+	const PackedRayMarchResult& pixel	= bufferData->d_GBuffer[bufferData->GetAtlasIndex(viewID, atlasX, atlasY)];
+
+	constexpr int NEIGHBOUR_OFFSETS[4][2] = {{-1, 0}, {1, 0}, {0, -1}, {0, 1}};
+
+	bool isEdge = false;
+	for (int i = 0; i < 4 && !isEdge; i++)
+	{
+		const int neighbourX = atlasX + NEIGHBOUR_OFFSETS[i][0];
+		const int neighbourY = atlasY + NEIGHBOUR_OFFSETS[i][1];
+		if (neighbourX < 0 || neighbourY < 0 || neighbourX >= viewQuality.AtlasDimensions.x || neighbourY >= viewQuality.AtlasDimensions.y)
+		{
+			continue;
+		}
+
+		const PackedRayMarchResult& neighbour = bufferData->d_GBuffer[bufferData->GetAtlasIndex(viewID, neighbourX, neighbourY)];
+		isEdge = IsEdgeBetween(pixel, neighbour, config, camera->ViewPaneDistance);
+	}
+
+	if (!isEdge)
+	{
+		return;
+	}
+
+	// Edges beyond the capacity keep their single sample.
+	const unsigned int edgeIndex = atomicAdd(bufferData->d_EdgePixelCount, 1u);
+	if (edgeIndex < bufferData->EdgePixelCapacity)
+	{
+		bufferData->d_EdgePixels[edgeIndex] = EdgePixel{static_cast<unsigned short>(viewID), static_cast<unsigned short>(atlasX), static_cast<unsigned short>(atlasY)};
+	}
+}
+
+////////////////////////////////////////////////////////////////
+
+// Element of the Halton sequence, used for the sub pixel offsets of the extra samples.
+A_CUDA_GPU float Halton(unsigned int index, const unsigned int base)
+{
+	float result		= 0.0f;
+	float fraction		= 1.0f / base;
+	while (index > 0)
+	{
+		result	+= fraction * (index % base);
+		index	/= base;
+		fraction	/= base;
+	}
+	return result;
+}
+
+////////////////////////////////////////////////////////////////
+
+// Shaded color of an extra sample of a pixel. Shadows and ambient occlusion are not marched per sample, the sample reuses the ones of the pixel.
+A_CUDA_GPU glm::vec4 ShadeExtraSample(const PackedRayMarchResult& pixel, RayMarchResult<glm::vec4>& result, Configuration* config)
+{
+	result.ShadowValue		= pixel.GetShadowValue();
+	result.AmbientOcclusion	= config->UseAmbientOcclusion ? pixel.GetAmbientOcclusion() : 1.0f;
+
+	const uchar4 color = VisualizationHelper::GetColorForRayResult(*config, result);
+	return glm::vec4(color.x, color.y, color.z, color.w);
+}
+
+////////////////////////////////////////////////////////////////
+
+A_CUDA_GPU glm::vec4 ToColorVector(const uchar4& color)
+{
+	return glm::vec4(color.x, color.y, color.z, color.w);
+}
+
+A_CUDA_GPU uchar4 ToColor(const glm::vec4& color)
+{
+	return make_uchar4(
+		static_cast<unsigned char>(color.x + 0.5f), 
+		static_cast<unsigned char>(color.y + 0.5f), 
+		static_cast<unsigned char>(color.z + 0.5f), 
+		static_cast<unsigned char>(color.w + 0.5f));
+}
+
+////////////////////////////////////////////////////////////////
+
+// Marches extra birays with sub pixel offsets for every pixel of the edge list and averages their shaded colors with the shaded pixel.
+template <ProjectionMethod PRIMARY, ProjectionMethod SECONDARY, unsigned int HIT_ATTRIBUTES>
+A_CUDA_KERNEL void k_SupersampleEdges(RenderPixelBufferDataCUDA* bufferData, RenderSceneDataCUDA* sceneData, Configuration* config, Camera<glm::vec4>* camera)
+{
+	const unsigned int edgeCount	= *bufferData->d_EdgePixelCount < bufferData->EdgePixelCapacity ? *bufferData->d_EdgePixelCount : bufferData->EdgePixelCapacity;
+	const int sampleCount			= config->EdgeSupersamplingSamples;
+
+	for (unsigned int edgeIndex = blockIdx.x * blockDim.x + threadIdx.x; edgeIndex < edgeCount; edgeIndex += gridDim.x * blockDim.x)
+	{
+		const EdgePixel edge				= bufferData->d_EdgePixels[edgeIndex];
+		const ViewQualityData& viewQuality	= bufferData->ViewQualities[edge.ViewID];
+		const unsigned int atlasIndex		= bufferData->GetAtlasIndex(edge.ViewID, edge.AtlasX, edge.AtlasY);
+		const PackedRayMarchResult& pixel	= bufferData->d_GBuffer[atlasIndex];
+
+		const float viewPercentage			= GetViewPercentage(edge.ViewID, bufferData->ViewCount);
+		const float pixelSizeX				= (1 << viewQuality.ResolutionShift) / static_cast<float>(bufferData->ViewDimensions.x);
+		const float pixelSizeY				= (1 << viewQuality.ResolutionShift) / static_cast<float>(bufferData->ViewDimensions.y);
+		const float inViewPercentageX		= (edge.AtlasX << viewQuality.ResolutionShift) / static_cast<float>(bufferData->ViewDimensions.x);
+		const float inViewPercentageY		= (edge.AtlasY << viewQuality.ResolutionShift) / static_cast<float>(bufferData->ViewDimensions.y);
+
+		glm::vec4 colorSum = ToColorVector(bufferData->d_ViewAtlas[atlasIndex]);
+		for (int i = 0; i < sampleCount; i++)
+		{
+			const float offsetX	= Halton(i + 1, 2) - 0.5f;
+			const float offsetY	= Halton(i + 1, 3) - 0.5f;
+
+			RayMarchResult<glm::vec4> result = MarchViewSample<PRIMARY, SECONDARY, HIT_ATTRIBUTES>(sceneData, config, camera, viewQuality, viewPercentage, 
+				inViewPercentageX + offsetX * pixelSizeX, inViewPercentageY + offsetY * pixelSizeY);
+			colorSum += ShadeExtraSample(pixel, result, config);
+		}
+
+		bufferData->d_ViewAtlas[atlasIndex] = ToColor(colorSum / static_cast<float>(sampleCount + 1));
+	}
+}
+
+////////////////////////////////////////////////////////////////
+// Variable Rate
+////////////////////////////////////////////////////////////////
+
+// A block is uniform if its anchors lie on the same surface without edges in between and, for draw modes with textures, in the same checker tile.
+// Tiles are convex, so the whole block then lies inside of the tile of its anchors.
+A_CUDA_GPU bool IsUniformBlock(const PackedRayMarchResult* const* anchors, Configuration* config, const float depthReference, const bool compareCheckerTiles)
+{
+	for (int i = 1; i < 4; i++)
+	{
+		if (IsEdgeBetween(*anchors[0], *anchors[i], config, depthReference))
+		{
+			return false;
+		}
+	}
+
+	if (!anchors[0]->IsHit() || !compareCheckerTiles)
+	{
+		return true;
+	}
+
+	// W_Heat uses half sized tiles, which also covers the regular ones.
+	const float tileSize	= config->CHECKERBOARD_SIZE / 2.0f;
+	const glm::vec4 tile	= glm::floor(anchors[0]->GetLocalPosition() / tileSize);
+	for (int i = 1; i < 4; i++)
+	{
+		if (glm::floor(anchors[i]->GetLocalPosition() / tileSize) != tile)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+////////////////////////////////////////////////////////////////
+
+// Fills the pixels between the anchors marched by k_MarchPixel. Uniform blocks are interpolated from their anchors, the others are marched per pixel.
+// All pixels of a block see the same anchors, so they agree on the classification.
+template <ProjectionMethod PRIMARY, ProjectionMethod SECONDARY, unsigned int HIT_ATTRIBUTES>
+A_CUDA_KERNEL void k_RefineVariableRate(RenderPixelBufferDataCUDA* bufferData, RenderSceneDataCUDA* sceneData, Configuration* config, Camera<glm::vec4>* camera)
+{
+	int viewID, atlasX, atlasY;
+	if (!GetAtlasPixel(bufferData, viewID, atlasX, atlasY))
+	{
+		return;
+	}
+
+	const int rate			= 1 << bufferData->VariableRateShift;
+	const int anchorMask	= rate - 1;
+	if ((atlasX & anchorMask) == 0 && (atlasY & anchorMask) == 0)
+	{
+		return;
+	}
+
+	const ViewQualityData& viewQuality	= bufferData->ViewQualities[viewID];
+	const float depthReference			= camera->ViewPaneDistance;
+
+	const int anchorX0	= atlasX & ~anchorMask;
+	const int anchorY0	= atlasY & ~anchorMask;
+	const int anchorX1	= anchorX0 + rate < viewQuality.AtlasDimensions.x ? anchorX0 + rate : anchorX0;
+	const int anchorY1	= anchorY0 + rate < viewQuality.AtlasDimensions.y ? anchorY0 + rate : anchorY0;
+	const float tx		= (atlasX - anchorX0) / static_cast<float>(rate);
+	const float ty		= (atlasY - anchorY0) / static_cast<float>(rate);
+
+	const PackedRayMarchResult* anchors[4] = {
+		&bufferData->d_GBuffer[bufferData->GetAtlasIndex(viewID, anchorX0, anchorY0)],
+		&bufferData->d_GBuffer[bufferData->GetAtlasIndex(viewID, anchorX1, anchorY0)],
+		&bufferData->d_GBuffer[bufferData->GetAtlasIndex(viewID, anchorX0, anchorY1)],
+		&bufferData->d_GBuffer[bufferData->GetAtlasIndex(viewID, anchorX1, anchorY1)]
+	};
+
+	PackedRayMarchResult& gBuffer = bufferData->d_GBuffer[bufferData->GetAtlasIndex(viewID, atlasX, atlasY)];
+	if (IsUniformBlock(anchors, config, depthReference, (HIT_ATTRIBUTES & Configuration::HitAttribute_LocalPosition) != 0))
+	{
+		const float bilinear[4] = {(1.0f - tx) * (1.0f - ty), tx * (1.0f - ty), (1.0f - tx) * ty, tx * ty};
+
+		// Continuous attributes are interpolated, the rest is taken from the nearest anchor.
+		const int nearest					= (tx < 0.5f ? 0 : 1) + (ty < 0.5f ? 0 : 2);
+		RayMarchResult<glm::vec4> result	= anchors[nearest]->ToRayMarchResult(depthReference);
+		result.Position						= glm::vec4(0.0f);
+		result.LocalPosition				= glm::vec4(0.0f);
+		result.TraversedPrimary				= 0.0f;
+		result.TraversedSecondary			= 0.0f;
+		result.SignedDistance				= 0.0f;
+		for (int i = 0; i < 4; i++)
+		{
+			const RayMarchResult<glm::vec4> anchor = anchors[i]->ToRayMarchResult(depthReference);
+			result.Position				+= anchor.Position * bilinear[i];
+			result.LocalPosition		+= anchor.LocalPosition * bilinear[i];
+			result.TraversedPrimary		+= anchor.TraversedPrimary * bilinear[i];
+			result.TraversedSecondary	+= anchor.TraversedSecondary * bilinear[i];
+			result.SignedDistance		+= anchor.SignedDistance * bilinear[i];
+		}
+		result.ShadowValue		= 1.0f;
+		result.AmbientOcclusion	= 1.0f;
+
+		gBuffer = PackedRayMarchResult(result, depthReference);
+		return;
+	}
+
+	const float inViewPercentageX = (atlasX << viewQuality.ResolutionShift) / static_cast<float>(bufferData->ViewDimensions.x);
+	const float inViewPercentageY = (atlasY << viewQuality.ResolutionShift) / static_cast<float>(bufferData->ViewDimensions.y);
+
+	RayMarchResult<glm::vec4> result = MarchViewSample<PRIMARY, SECONDARY, HIT_ATTRIBUTES>(sceneData, config, camera, viewQuality, GetViewPercentage(viewID, bufferData->ViewCount), inViewPercentageX, inViewPercentageY);
+	result.ShadowValue = 1.0f;
+
+	gBuffer = PackedRayMarchResult(result, depthReference);
+}
+
+////////////////////////////////////////////////////////////////
+// Progressive Refinement
+////////////////////////////////////////////////////////////////
+
+// Nearest neighbour upscale of a coarse progressive pass. Every pixel off the march grid copies the anchor of its block.
+A_CUDA_KERNEL void k_FillProgressive(RenderPixelBufferDataCUDA* bufferData)
+{
+	int viewID, atlasX, atlasY;
+	if (!GetAtlasPixel(bufferData, viewID, atlasX, atlasY))
+	{
+		return;
+	}
+
+	const int anchorMask = (1 << bufferData->MarchRateShift) - 1;
+	if ((atlasX & anchorMask) == 0 && (atlasY & anchorMask) == 0)
+	{
+		return;
+	}
+
+	bufferData->d_GBuffer[bufferData->GetAtlasIndex(viewID, atlasX, atlasY)] = bufferData->d_GBuffer[bufferData->GetAtlasIndex(viewID, atlasX & ~anchorMask, atlasY & ~anchorMask)];
+}
+
+////////////////////////////////////////////////////////////////
+// Progressive Anti-Aliasing
+////////////////////////////////////////////////////////////////
+
+// Marches one biray per pixel with a sub pixel offset and averages its color into the history, which then replaces the shaded pixel.
+// The first accumulated frame starts the history from the shaded pixel, so the history holds the unjittered sample and one per frame since.
+template <ProjectionMethod PRIMARY, ProjectionMethod SECONDARY, unsigned int HIT_ATTRIBUTES>
+A_CUDA_KERNEL void k_AccumulateAntiAliasing(RenderPixelBufferDataCUDA* bufferData, RenderSceneDataCUDA* sceneData, Configuration* config, Camera<glm::vec4>* camera)
+{
+	int viewID, atlasX, atlasY;
+	if (!GetAtlasPixel(bufferData, viewID, atlasX, atlasY))
+	{
+		return;
+	}
+
+	const ViewQualityData& viewQuality	= bufferData->ViewQualities[viewID];
+	const unsigned int atlasIndex		= bufferData->GetAtlasIndex(viewID, atlasX, atlasY);
+	const unsigned int frame			= bufferData->AntiAliasingFrame;
+
+	// The same offsets for all pixels, they cover the pixel evenly over the frames. Halton(1, 2) would hit the pixel center again.
+	const float offsetX					= Halton(frame + 1, 2) - 0.5f;
+	const float offsetY					= Halton(frame + 1, 3) - 0.5f;
+	const float inViewPercentageX		= ((atlasX << viewQuality.ResolutionShift) + offsetX * (1 << viewQuality.ResolutionShift)) / static_cast<float>(bufferData->ViewDimensions.x);
+	const float inViewPercentageY		= ((atlasY << viewQuality.ResolutionShift) + offsetY * (1 << viewQuality.ResolutionShift)) / static_cast<float>(bufferData->ViewDimensions.y);
+
+	RayMarchResult<glm::vec4> result	= MarchViewSample<PRIMARY, SECONDARY, HIT_ATTRIBUTES>(sceneData, config, camera, viewQuality, GetViewPercentage(viewID, bufferData->ViewCount), inViewPercentageX, inViewPercentageY);
+	const glm::vec4 sampleColor			= ShadeExtraSample(bufferData->d_GBuffer[atlasIndex], result, config);
+
+	glm::vec4& history					= bufferData->d_AntiAliasingHistory[atlasIndex];
+	const glm::vec4 previous			= frame == 1 ? ToColorVector(bufferData->d_ViewAtlas[atlasIndex]) : history;
+
+	history = previous + (sampleColor - previous) / static_cast<float>(frame + 1);
+	bufferData->d_ViewAtlas[atlasIndex] = ToColor(history);
+}
+
+////////////////////////////////////////////////////////////////
+
+A_CUDA_GPU uchar4 LerpColor(const uchar4& a, const uchar4& b, const float t)
+{
+	return make_uchar4(
+		static_cast<unsigned char>(a.x + (b.x - a.x) * t + 0.5f),
+		static_cast<unsigned char>(a.y + (b.y - a.y) * t + 0.5f),
+		static_cast<unsigned char>(a.z + (b.z - a.z) * t + 0.5f),
+		static_cast<unsigned char>(a.w + (b.w - a.w) * t + 0.5f));
+}
+
+////////////////////////////////////////////////////////////////
+
+A_CUDA_KERNEL void k_PresentViewAtlas(RenderPixelBufferDataCUDA* bufferData)
+{
+	const int pixelX		= blockIdx.x * blockDim.x + threadIdx.x;
+	const int pixelY		= blockIdx.y * blockDim.y + threadIdx.y;
+	if (pixelX >= bufferData->BufferDimensions.x || pixelY >= bufferData->BufferDimensions.y)
+	{
+		return;
+	}
+
+	const int viewX			= pixelX / bufferData->ViewDimensions.x; 
+	const int viewY			= pixelY / bufferData->ViewDimensions.y;
+	const int viewID		= viewY * bufferData->NumViews.x + viewX;
+
+	const int inViewX		= pixelX - viewX * bufferData->ViewDimensions.x;
+	const int inViewY		= pixelY - viewY * bufferData->ViewDimensions.y;
+
+	const ViewQualityData& viewQuality = bufferData->ViewQualities[viewID];
+
+	uchar4 color;
+	if (viewQuality.ResolutionShift == 0)
+	{
+		color = bufferData->d_ViewAtlas[bufferData->GetAtlasIndex(viewID, inViewX, inViewY)];
+	}
+	else
+	{
+		// Bilinear upscale. Atlas pixel (i, j) was rendered for the view pixel (i << shift, j << shift).
+		const float scale	= 1.0f / static_cast<float>(1 << viewQuality.ResolutionShift);
+		const float atlasX	= inViewX * scale;
+		const float atlasY	= inViewY * scale;
+
+		const int x0		= static_cast<int>(atlasX);
+		const int y0		= static_cast<int>(atlasY);
+		const int x1		= min(x0 + 1, viewQuality.AtlasDimensions.x - 1);
+		const int y1		= min(y0 + 1, viewQuality.AtlasDimensions.y - 1);
+		const float tx		= atlasX - x0;
+		const float ty		= atlasY - y0;
+
+		const uchar4 top	= LerpColor(bufferData->d_ViewAtlas[bufferData->GetAtlasIndex(viewID, x0, y0)], bufferData->d_ViewAtlas[bufferData->GetAtlasIndex(viewID, x1, y0)], tx);
+		const uchar4 bottom	= LerpColor(bufferData->d_ViewAtlas[bufferData->GetAtlasIndex(viewID, x0, y1)], bufferData->d_ViewAtlas[bufferData->GetAtlasIndex(viewID, x1, y1)], tx);
+		color				= LerpColor(top, bottom, ty);
+	}
+
 	surf2Dwrite(color, bufferData->SurfaceObject, RESULT_COLOR_COMPONENT_COUNT * sizeof(BufferType) * pixelX, pixelY);
 }
\ No newline at end of file
@@ -4,10 +4,44 @@
 #include "Marching/MarchingTypes.h"
 
 #include "Rendering/CUDATypes.h"
+#include "Rendering/QuiltTypes.h"
 #include "Rendering/Scenes/SceneHyperPlayground.h"
 
+#include "Options/Configuration.h"
+
 class SceneHyperPlayground;
 
+// Which parts of the last frame are outdated. Each level implies all levels below it.
+enum class RenderInvalidation : unsigned int
+{
+	None		= 0,	// < Nothing changed, the last frame can be kept.
+	Shading		= 1,	// < Only the shading pass needs to run on the G-buffer.
+	Lighting	= 2,	// < Primary hits are still valid, but shadows need to be recomputed.
+	Geometry	= 3,	// < Primary hits changed, everything needs to be marched again.
+};
+
+//////////////////////////////////////////////////////////////////////////
+
+// Accumulated stochastic shadow of one atlas pixel. The position is used to reject the history after reprojection.
+struct ShadowHistorySample
+{
+	glm::vec4	Position		= glm::vec4(0.0f);
+	float		Visibility		= 0.0f;
+	float		SampleCount		= 0.0f;
+};
+
+//////////////////////////////////////////////////////////////////////////
+
+// Pixel of the view atlas that lies on an edge and gets supersampled.
+struct EdgePixel
+{
+	unsigned short ViewID;
+	unsigned short AtlasX;
+	unsigned short AtlasY;
+};
+
+//////////////////////////////////////////////////////////////////////////
+
 struct RenderPixelBufferDataCUDA
 {		
 	// Buffer Data
@@ -17,6 +51,45 @@ struct RenderPixelBufferDataCUDA
 	glm::ivec2	ViewDimensions				= {0, 0};
 	glm::ivec2	NumViews					= {0, 0};
 
+	// View Atlas
+	// Every view is rendered at its own resolution into the atlas, which is then upscaled into the surface.
+	uchar4*			d_ViewAtlas				= nullptr;
+	PackedRayMarchResult* d_GBuffer		= nullptr;		// < Same layout as the view atlas.
+	ViewQualityData	ViewQualities[MAX_VIEW_COUNT];
+	unsigned int	ViewCount				= 0;
+
+	// Mask of Configuration::HitAttributes. Host side copy of the active draw mode requirements, used to pick the march kernel.
+	unsigned int	HitAttributes			= Configuration::HitAttribute_All;
+	unsigned int	ShadowRateShift			= 0;
+	unsigned int	VariableRateShift		= 0;
+	unsigned int	MarchRateShift			= 0;		// < Stride of the march pass of this frame. Coarser than VariableRateShift for progressive passes.
+	bool			IsProgressiveRefinement	= false;	// < The pixels of the next coarser grid were marched by an earlier frame.
+
+	// Stochastic Shadows
+	// Two history buffers with the same layout as the view atlas, swapped every frame that casts stochastic shadows.
+	bool			UseStochasticShadows	= false;
+	ShadowHistorySample* d_ShadowHistory			= nullptr;
+	ShadowHistorySample* d_PreviousShadowHistory	= nullptr;
+	unsigned int	ShadowFrameIndex		= 0;		// < Seeds the jitter of the shadow rays.
+	bool			ResetShadowHistory		= true;		// < Set if the light or scene changed, which makes the history unusable.
+
+	// Ambient Occlusion
+	// Accumulated in the G-buffer, so it is kept until the next march and only refined while the G-buffer stays the same.
+	bool			ComputeAmbientOcclusion	= false;
+	unsigned int	AmbientOcclusionFrame	= 0;		// < Frames accumulated since the last march. The first one uses unjittered taps.
+
+	// Edge Supersampling
+	// Compacted list of the edge pixels of the current frame. The count lives in device memory and is reset before the edges are detected.
+	bool			UseEdgeSupersampling	= false;
+	EdgePixel*		d_EdgePixels			= nullptr;
+	unsigned int*	d_EdgePixelCount		= nullptr;
+	unsigned int	EdgePixelCapacity		= 0;
+
+	// Progressive Anti-Aliasing
+	// Running mean of the jittered frames since the last change, same layout as the view atlas. Frame 0 does not accumulate.
+	glm::vec4*		d_AntiAliasingHistory	= nullptr;
+	unsigned int	AntiAliasingFrame		= 0;
+
 	RenderPixelBufferDataCUDA() = default;
 	A_CUDA_CPUGPU void Initialize(const cudaSurfaceObject_t surfaceObject, const glm::ivec2& bufferDimensions, const glm::ivec2& viewDimensions, const glm::ivec2& numViews)
 	{
@@ -25,37 +98,393 @@ struct RenderPixelBufferDataCUDA
 		ViewDimensions		= viewDimensions;
 		NumViews			= numViews;
 	}
+
+	void InitializeViewAtlas(uchar4* const d_viewAtlas, PackedRayMarchResult* const d_gBuffer, const QuiltConfigurationData& quiltConfigData)
+	{
+		d_ViewAtlas			= d_viewAtlas;
+		d_GBuffer			= d_gBuffer;
+		ViewCount			= quiltConfigData.ViewCount;
+		for (unsigned int i = 0; i < ViewCount; i++)
+		{
+			ViewQualities[i] = quiltConfigData.ViewQualities[i];
+		}
+	}
+
+	void InitializeShadowHistory(ShadowHistorySample* const d_shadowHistory, ShadowHistorySample* const d_previousShadowHistory, const unsigned int shadowFrameIndex, const bool resetShadowHistory)
+	{
+		d_ShadowHistory			= d_shadowHistory;
+		d_PreviousShadowHistory	= d_previousShadowHistory;
+		ShadowFrameIndex		= shadowFrameIndex;
+		ResetShadowHistory		= resetShadowHistory;
+	}
+
+	void InitializeEdgeList(EdgePixel* const d_edgePixels, unsigned int* const d_edgePixelCount, const unsigned int edgePixelCapacity)
+	{
+		d_EdgePixels		= d_edgePixels;
+		d_EdgePixelCount	= d_edgePixelCount;
+		EdgePixelCapacity	= edgePixelCapacity;
+	}
+
+	A_CUDA_CPUGPU unsigned int GetAtlasIndex(const unsigned int viewID, const int atlasX, const int atlasY) const
+	{
+		const ViewQualityData& view = ViewQualities[viewID];
+		return view.AtlasOffset + atlasY * view.AtlasDimensions.x + atlasX;
+	}
+};
+
+//////////////////////////////////////////////////////////////////////////
+
+// Precomputed shadow visibility around the scene, for lights and scenes that do not move.
+// The grid is parametrized from the light: three gnomonic (tangent plane) coordinates around the axis from the light to the scene center, and the distance to the light.
+// Cells inside of geometry have no meaningful visibility, they are marked as unknown and skipped by the lookup.
+struct RenderShadowGridDataCUDA
+{
+	static constexpr int	RESOLUTION			= 32;
+	static constexpr int	CELL_COUNT			= RESOLUTION * RESOLUTION * RESOLUTION * RESOLUTION;
+	static constexpr float	UNKNOWN_VISIBILITY	= -1.0f;
+
+	float*		d_Visibility		= nullptr;
+
+	glm::vec4	LightPosition		= glm::vec4(0.0f);
+	float		LightRadius			= 0.0f;
+	glm::vec4	Axis				= glm::vec4(0.0f);
+	glm::vec4	Tangents[3]			= {};
+	float		TangentExtent		= 0.0f;		// < Half extent of the tangent coordinates, so that the bounding hypersphere of the scene is covered.
+	float		MinDistance			= 0.0f;
+	float		MaxDistance			= 0.0f;
+
+	bool		IsEnabled			= false;	// < Host side copy of Configuration::UseShadowVisibilityGrid.
+	bool		IsDirty				= true;		// < Set by the main thread if the light or the scene changed.
+	bool		IsValid				= false;	// < False if the light lies inside of the scene bounds, which the parametrization can not cover.
+
+	RenderShadowGridDataCUDA() = default;
+	void Initialize(float* const d_visibility)
+	{
+		d_Visibility	= d_visibility;
+		IsDirty			= true;
+		IsValid			= false;
+	}
+
+	//////////////////////////////////////////////////////////////////////////
+
+	// Fits the grid around the bounds of the scene as seen from the light.
+	void Fit(const glm::vec4& lightPosition, const float lightRadius, const Math::Hypershere& sceneBounds)
+	{
+		LightPosition				= lightPosition;
+		LightRadius					= lightRadius;
+
+		const glm::vec4 toScene		= sceneBounds.Origin - lightPosition;
+		const float sceneDistance	= glm::length(toScene);
+
+		IsValid = sceneDistance > sceneBounds.Radius;
+		if (!IsValid)
+		{
+			return;
+		}
+
+		Axis = toScene / sceneDistance;
+
+		// Gram-Schmidt on the unit axes, skipping the one most aligned with the light axis.
+		int skippedAxis = 0;
+		for (int i = 1; i < 4; i++)
+		{
+			if (glm::abs(Axis[i]) > glm::abs(Axis[skippedAxis]))
+			{
+				skippedAxis = i;
+			}
+		}
+
+		int tangentID = 0;
+		for (int i = 0; i < 4; i++)
+		{
+			if (i == skippedAxis)
+			{
+				continue;
+			}
+
+			glm::vec4 tangent	= glm::vec4(0.0f);
+			tangent[i]			= 1.0f;
+			tangent				-= Axis * glm::dot(tangent, Axis);
+			for (int j = 0; j < tangentID; j++)
+			{
+				tangent -= Tangents[j] * glm::dot(tangent, Tangents[j]);
+			}
+			Tangents[tangentID++] = glm::normalize(tangent);
+		}
+
+		TangentExtent	= sceneBounds.Radius / glm::sqrt(sceneDistance * sceneDistance - sceneBounds.Radius * sceneBounds.Radius);
+		MinDistance		= sceneDistance - sceneBounds.Radius;
+		MaxDistance		= sceneDistance + sceneBounds.Radius;
+	}
+
+	//////////////////////////////////////////////////////////////////////////
+
+	A_CUDA_CPUGPU glm::vec4 GetCellPosition(const int cellIndex) const
+	{
+		int coordinates[4];
+		int remainder = cellIndex;
+		for (int i = 0; i < 4; i++)
+		{
+			coordinates[i]	= remainder % RESOLUTION;
+			remainder		/= RESOLUTION;
+		}
+
+		constexpr float TO_PERCENTAGE	= 1.0f / (RESOLUTION - 1);
+		glm::vec4 direction				= Axis;
+		for (int i = 0; i < 3; i++)
+		{
+			direction += Tangents[i] * ((coordinates[i] * TO_PERCENTAGE * 2.0f - 1.0f) * TangentExtent);
+		}
+
+		const float distance = MinDistance + coordinates[3] * TO_PERCENTAGE * (MaxDistance - MinDistance);
+		return LightPosition + glm::normalize(direction) * distance;
+	}
+
+	//////////////////////////////////////////////////////////////////////////
+
+	// Quadrilinear interpolation of the known cells around the position. Returns false if the grid does not cover the position.
+	A_CUDA_CPUGPU bool SampleVisibility(const glm::vec4& position, float& outVisibility) const
+	{
+		if (!IsValid)
+		{
+			return false;
+		}
+
+		const glm::vec4 fromLight	= position - LightPosition;
+		const float alongAxis		= glm::dot(fromLight, Axis);
+		if (alongAxis <= 0.0f)
+		{
+			return false;
+		}
+
+		float gridCoordinates[4];
+		for (int i = 0; i < 3; i++)
+		{
+			gridCoordinates[i] = (glm::dot(fromLight, Tangents[i]) / (alongAxis * TangentExtent) * 0.5f + 0.5f) * (RESOLUTION - 1);
+		}
+		gridCoordinates[3] = (glm::length(fromLight) - MinDistance) / (MaxDistance - MinDistance) * (RESOLUTION - 1);
+
+		int baseCell[4];
+		float fraction[4];
+		for (int i = 0; i < 4; i++)
+		{
+			if (gridCoordinates[i] < 0.0f || gridCoordinates[i] > RESOLUTION - 1)
+			{
+				return false;
+			}
+
+			const int cell	= static_cast<int>(gridCoordinates[i]);
+			baseCell[i]		= cell < RESOLUTION - 2 ? cell : RESOLUTION - 2;
+			fraction[i]		= gridCoordinates[i] - baseCell[i];
+		}
+
+		float weightedVisibility	= 0.0f;
+		float knownWeight			= 0.0f;
+		for (int corner = 0; corner < 16; corner++)
+		{
+			int cellIndex	= 0;
+			int stride		= 1;
+			float weight	= 1.0f;
+			for (int i = 0; i < 4; i++)
+			{
+				const int offset	= (corner >> i) & 1;
+				cellIndex			+= (baseCell[i] + offset) * stride;
+				stride				*= RESOLUTION;
+				weight				*= offset ? fraction[i] : 1.0f - fraction[i];
+			}
+
+			const float visibility = d_Visibility[cellIndex];
+			if (visibility != UNKNOWN_VISIBILITY)
+			{
+				weightedVisibility	+= visibility * weight;
+				knownWeight			+= weight;
+			}
+		}
+
+		// Mostly surrounded by geometry, the interpolation would not be trustworthy.
+		constexpr float MIN_KNOWN_WEIGHT = 0.05f;
+		if (knownWeight < MIN_KNOWN_WEIGHT)
+		{
+			return false;
+		}
+
+		outVisibility = weightedVisibility / knownWeight;
+		return true;
+	}
 };
 
 //////////////////////////////////////////////////////////////////////////
 
+// One brick of the distance cache. Neighbouring bricks share their border samples, so an interpolation never has to leave its brick.
 struct RenderVoxelDataCUDA
 {
-	using ResultType = RayMarchResult<glm::vec4>;
-	ResultType Result;
+	static constexpr int BRICK_SIZE		= 8;
+	static constexpr int SAMPLE_COUNT	= BRICK_SIZE * BRICK_SIZE * BRICK_SIZE * BRICK_SIZE;
 
-	RenderVoxelDataCUDA() = delete;
-	explicit RenderVoxelDataCUDA(const ResultType& result) : Result(result) {};
+	float Distances[SAMPLE_COUNT];
 };
 
 //////////////////////////////////////////////////////////////////////////
 
+// Sparse cache of a static SDF. A coarse 4D grid is laid over its bounds, and only cells near the surface (the narrow band) get a brick
+// of distance samples, which is interpolated quadrilinearly. Every other cell stores the exact distance at its center, which bounds the 
+// distance anywhere in the cell. Samples outside of the grid, or too close to the surface to trust the interpolation, need an exact evaluation.
+// The bricks are filled by the rendering thread over several frames, the cache is only used once all of them are done.
 struct RenderVoxelBufferDataCUDA
 {
-	// Buffer Data
-	glm::ivec3 VolumeOriginWS	= {0, 0, 0};
-	glm::ivec3 VolumeSizeWS		= {20, 20, 20};
-	glm::ivec3 BufferDimensions	= {20, 20, 20};
+	static constexpr int	RESOLUTION			= 32;
+	static constexpr int	CELL_COUNT			= RESOLUTION * RESOLUTION * RESOLUTION * RESOLUTION;
+	static constexpr int	MAX_BRICKS			= 4096;		// < 64 MB of bricks. Band cells beyond that are evaluated exactly, see OverflowCellCount.
+	static constexpr int	BRICKS_PER_FRAME	= 256;
+	static constexpr int	NO_BRICK			= -1;		// < Cell outside of the narrow band
+	static constexpr int	OVERFLOW_BRICK		= -2;		// < Cell inside of the narrow band, but the brick pool was full
+
+	RenderVoxelDataCUDA*	mcm_VolumeBuffer	= nullptr;	// < MAX_BRICKS bricks
+	int*					mcm_BrickTable		= nullptr;	// < CELL_COUNT brick indices, NO_BRICK or OVERFLOW_BRICK
+	float*					mcm_CellDistances	= nullptr;	// < CELL_COUNT exact distances at the cell centers
+	int*					mcm_BrickCells		= nullptr;	// < MAX_BRICKS cell indices, plus the brick counter at [MAX_BRICKS]
 
-	RenderVoxelDataCUDA* d_VolumeBuffer = nullptr;
+	glm::vec4	VolumeOrigin		= glm::vec4(0.0f);
+	float		CellSize			= 0.0f;
+	float		VoxelSize			= 0.0f;		// < Distance between two samples of a brick.
+
+	int			BrickCount			= 0;
+	int			FilledBrickCount	= 0;
+	int			OverflowCellCount	= 0;		// < Band cells that did not get a brick. Large object fields overflow the pool, see the options.
+	bool		IsEnabled			= false;	// < Host side copy of Configuration::SceneUseBrickCache.
+	bool		IsDirty				= false;	// < Set if the cached SDF or its bounds changed.
+	bool		IsClassified		= false;	// < The brick table is up to date, only bricks are left to fill.
+	bool		IsValid				= false;	// < All bricks are filled.
 
 	RenderVoxelBufferDataCUDA() = default;
-	A_CUDA_CPUGPU void Initialize(RenderVoxelDataCUDA* const d_volumeBuffer, const glm::ivec3& bufferDimensions, const glm::ivec3& volumeOriginWS, const glm::ivec3& volumeSizeWS)
+	void Initialize(RenderVoxelDataCUDA* const volumeBuffer, int* const brickTable, float* const cellDistances, int* const brickCells)
 	{
-		d_VolumeBuffer		= d_volumeBuffer;
-		BufferDimensions	= bufferDimensions;
-		VolumeOriginWS		= volumeOriginWS;
-		VolumeSizeWS		= volumeSizeWS;
+		mcm_VolumeBuffer	= volumeBuffer;
+		mcm_BrickTable		= brickTable;
+		mcm_CellDistances	= cellDistances;
+		mcm_BrickCells		= brickCells;
+	}
+
+	//////////////////////////////////////////////////////////////////////////
+
+	// Lays the grid over the bounds of the cached SDF and discards all bricks.
+	void Fit(const Math::Hypershere& bounds)
+	{
+		VolumeOrigin		= bounds.Origin - glm::vec4(bounds.Radius);
+		CellSize			= 2.0f * bounds.Radius / RESOLUTION;
+		VoxelSize			= CellSize / (RenderVoxelDataCUDA::BRICK_SIZE - 1);
+		BrickCount			= 0;
+		OverflowCellCount	= 0;
+		IsDirty				= bounds.Radius > 0.0f;
+		IsClassified		= false;
+		IsValid				= false;
+	}
+
+	//////////////////////////////////////////////////////////////////////////
+
+	A_CUDA_CPUGPU glm::vec4 GetCellOrigin(int cellIndex) const
+	{
+		glm::vec4 coordinates;
+		for (int i = 0; i < 4; i++)
+		{
+			coordinates[i]	= static_cast<float>(cellIndex % RESOLUTION);
+			cellIndex		/= RESOLUTION;
+		}
+		return VolumeOrigin + coordinates * CellSize;
+	}
+
+	A_CUDA_CPUGPU glm::vec4 GetCellCenter(const int cellIndex) const
+	{
+		return GetCellOrigin(cellIndex) + glm::vec4(0.5f * CellSize);
+	}
+
+	// Samples include both borders of their cell.
+	A_CUDA_CPUGPU glm::vec4 GetSamplePosition(const int brickIndex, int sampleIndex) const
+	{
+		glm::vec4 coordinates;
+		for (int i = 0; i < 4; i++)
+		{
+			coordinates[i]	= static_cast<float>(sampleIndex % RenderVoxelDataCUDA::BRICK_SIZE);
+			sampleIndex		/= RenderVoxelDataCUDA::BRICK_SIZE;
+		}
+		return GetCellOrigin(mcm_BrickCells[brickIndex]) + coordinates * VoxelSize;
+	}
+
+	//////////////////////////////////////////////////////////////////////////
+
+	// Cells whose center is closer to the surface than this get a brick. This is the half diagonal of a 4D cell plus one cell,
+	// so that the bound of a cell without brick never gets smaller than one cell.
+	A_CUDA_CPUGPU float GetNarrowBandDistance() const
+	{
+		return 2.0f * CellSize;
+	}
+
+	//////////////////////////////////////////////////////////////////////////
+
+	// Returns false if the position needs an exact evaluation.
+	A_CUDA_CPUGPU bool TryEvaluateDistance(const glm::vec4& position, float& outDistance) const
+	{
+		if (!IsValid)
+		{
+			return false;
+		}
+
+		const glm::vec4 gridPosition	= (position - VolumeOrigin) / CellSize;
+		const glm::vec4 cellCoordinates	= glm::floor(gridPosition);
+		if (Math::MinComponent(cellCoordinates) < 0.0f || Math::MaxComponent(cellCoordinates) >= RESOLUTION)
+		{
+			return false;
+		}
+
+		int cellIndex	= 0;
+		int stride		= 1;
+		for (int i = 0; i < 4; i++)
+		{
+			cellIndex	+= static_cast<int>(cellCoordinates[i]) * stride;
+			stride		*= RESOLUTION;
+		}
+
+		const int brickIndex = mcm_BrickTable[cellIndex];
+		if (brickIndex == OVERFLOW_BRICK)
+		{
+			return false;
+		}
+		if (brickIndex == NO_BRICK)
+		{
+			// The distance changes by at most the distance moved, and the center is far enough from the surface to keep the sign.
+			const float centerDistance	= mcm_CellDistances[cellIndex];
+			const float offset			= Math::Length(position - GetCellCenter(cellIndex));
+			outDistance					= (centerDistance > 0.0f) ? centerDistance - offset : centerDistance + offset;
+			return true;
+		}
+
+		constexpr int BRICK_SIZE		= RenderVoxelDataCUDA::BRICK_SIZE;
+		const glm::vec4 samplePosition	= (gridPosition - cellCoordinates) * static_cast<float>(BRICK_SIZE - 1);
+		const glm::vec4 baseSample		= glm::clamp(glm::floor(samplePosition), glm::vec4(0.0f), glm::vec4(BRICK_SIZE - 2));
+		const glm::vec4 fraction		= samplePosition - baseSample;
+		const float* distances			= mcm_VolumeBuffer[brickIndex].Distances;
+
+		float distance = 0.0f;
+		for (int corner = 0; corner < 16; corner++)
+		{
+			int sampleIndex		= 0;
+			int sampleStride	= 1;
+			float weight		= 1.0f;
+			for (int i = 0; i < 4; i++)
+			{
+				const int offset	= (corner >> i) & 1;
+				sampleIndex			+= (static_cast<int>(baseSample[i]) + offset) * sampleStride;
+				sampleStride		*= BRICK_SIZE;
+				weight				*= offset ? fraction[i] : 1.0f - fraction[i];
+			}
+
+			distance += distances[sampleIndex] * weight;
+		}
+
+		// Each corner is at most half the voxel diagonal further away than the sample, so the interpolation overestimates by at most that.
+		// In 4D that is sqrt(4) * VoxelSize / 2 = VoxelSize, e.g. for a point-like feature in the middle of a voxel.
+		outDistance = distance - VoxelSize;
+		return true;
 	}
 };
 
@@ -109,8 +538,42 @@ struct A_CPUGPU_ALIGN(8) RenderSceneDataCUDA
 
 	////////////////////////////////////////////////////////////////
 
+	A_CUDA_CPUGPU glm::vec4 EvaluateToSurfaceVectorZWFromDistance(const glm::vec4& position, const float distance) const
+	{
+		return mcm_Scene->EvaluateToSurfaceVectorZWFromDistance(position, distance);
+	}
+
+	////////////////////////////////////////////////////////////////
+
 	A_CUDA_CPUGPU glm::vec4 GetLocalSamplePosition(const glm::vec4& position) const
 	{
 		return mcm_Scene->GetLocalSamplePosition(position);
 	}
+
+	////////////////////////////////////////////////////////////////
+
+	A_CUDA_CPUGPU bool IsAnalytic() const
+	{
+		return mcm_Scene->IsAnalytic();
+	}
+
+	A_CUDA_CPUGPU bool IntersectAnalytic(const Math::BiRay<glm::vec4>& biRay, const float maxDistance, Math::BiRayHit& outHit) const
+	{
+		return mcm_Scene->IntersectAnalytic(biRay, maxDistance, outHit);
+	}
+
+	////////////////////////////////////////////////////////////////
+
+	// Exact distance to the static part of the scene that is cached in the brick cache, in the frame it is cached in.
+	A_CUDA_CPUGPU float EvaluateCachedDistance(const glm::vec4& position) const
+	{
+		return mcm_Scene->EvaluateStaticObjectsDistance(position);
+	}
+
+	////////////////////////////////////////////////////////////////
+
+	Math::Hypershere GetBoundingHypersphere() const
+	{
+		return mcm_Scene->GetBoundingHypersphere();
+	}
 };
@@ -161,13 +161,31 @@ struct A_CPUGPU_ALIGN(256) Camera
 
 	//////////////////////////////////////////////////////////////////////////
 
+	A_CUDA_CPUGPU inline Math::BiRay<VectorType> GetBiray(float viewPercentage, float inViewPercentageX, float inViewPercentageY, ToWorldSpaceMatrix_t& outToWorldSpaceMatrix) const
+	{
+		if (PrimaryProjectionMethod == ProjectionMethod::Perspectve)
+		{
+			return SecondaryProjectionMethod == ProjectionMethod::Perspectve
+				? GetBiray<ProjectionMethod::Perspectve, ProjectionMethod::Perspectve>(viewPercentage, inViewPercentageX, inViewPercentageY, outToWorldSpaceMatrix)
+				: GetBiray<ProjectionMethod::Perspectve, ProjectionMethod::Parallel>(viewPercentage, inViewPercentageX, inViewPercentageY, outToWorldSpaceMatrix);
+		}
+
+		return SecondaryProjectionMethod == ProjectionMethod::Perspectve
+			? GetBiray<ProjectionMethod::Parallel, ProjectionMethod::Perspectve>(viewPercentage, inViewPercentageX, inViewPercentageY, outToWorldSpaceMatrix)
+			: GetBiray<ProjectionMethod::Parallel, ProjectionMethod::Parallel>(viewPercentage, inViewPercentageX, inViewPercentageY, outToWorldSpaceMatrix);
+	}
+
+	//////////////////////////////////////////////////////////////////////////
+
+	// Same as above, but with the projection methods resolved at compile time. Used by the specialized march kernels.
+	template <ProjectionMethod PRIMARY, ProjectionMethod SECONDARY>
 	A_CUDA_CPUGPU inline Math::BiRay<VectorType> GetBiray(float viewPercentage, float inViewPercentageX, float inViewPercentageY, ToWorldSpaceMatrix_t& outToWorldSpaceMatrix) const
 	{
 		VectorType birayOrigin				= GetOriginPosition(viewPercentage);
 		VectorType birayMainDirection		= ForwardVector;	// Parallel projection as a default
 		VectorType biraySecondaryDirection	= OverVector;		// Parallel projection as a default
 
-		if (PrimaryProjectionMethod == ProjectionMethod::Perspectve)
+		if constexpr (PRIMARY == ProjectionMethod::Perspectve)
 		{
 			const VectorType targetPosition	= GetPrimaryViewPaneTargetPosition(inViewPercentageX, inViewPercentageY);
 			birayMainDirection = glm::normalize(targetPosition - birayOrigin);
@@ -177,7 +195,7 @@ struct A_CPUGPU_ALIGN(256) Camera
 			birayOrigin	+= GetViewPaneTargetOffset(inViewPercentageX, inViewPercentageY);
 		}
 
-		if (SecondaryProjectionMethod == ProjectionMethod::Perspectve)
+		if constexpr (SECONDARY == ProjectionMethod::Perspectve)
 		{
 			const VectorType targetPosition	= GetSecondaryViewPaneTargetPosition(inViewPercentageX, inViewPercentageY);
 			biraySecondaryDirection	= glm::normalize(targetPosition - birayOrigin);
@@ -217,6 +235,41 @@ struct A_CPUGPU_ALIGN(256) Camera
 
 	//////////////////////////////////////////////////////////////////////////
 
+	// Inverse of GetBiray: finds the pixel of the given view whose biray plane contains the position. Returns false if no pixel of the view does.
+	// The biray spans origin + a * mainDirection + b * secondaryDirection. The forward and over components of the position fix a and b, right and up then fix the pixel.
+	A_CUDA_CPUGPU inline bool ProjectToView(const VectorType& position, float viewPercentage, float& outInViewPercentageX, float& outInViewPercentageY) const
+	{
+		const float primaryParallel		= PrimaryProjectionMethod == ProjectionMethod::Parallel ? 1.0f : 0.0f;
+		const float secondaryParallel	= SecondaryProjectionMethod == ProjectionMethod::Parallel ? 1.0f : 0.0f;
+
+		const VectorType viewOrigin		= GetOriginPosition(viewPercentage);
+		const VectorType toPosition		= position - viewOrigin;
+		const float originOffset		= glm::dot(viewOrigin - Position, RightVector);
+
+		const float a					= glm::dot(toPosition, ForwardVector) / (primaryParallel > 0.0f ? 1.0f : ViewPaneDistance);
+		const float b					= glm::dot(toPosition, OverVector) / (secondaryParallel > 0.0f ? 1.0f : ViewPaneDistance);
+		if (a < 0.0f || b < 0.0f)
+		{
+			return false;
+		}
+
+		// Every parallel projection shifts the origin by the pane offset, every perspective one tilts its direction by it.
+		const float paneScale			= primaryParallel + secondaryParallel + (1.0f - primaryParallel) * a * ViewPanePrimarySizeFactor + (1.0f - secondaryParallel) * b * (ViewPaneSecondarySizeFactor - primaryParallel);
+		if (glm::abs(paneScale) < 0.000001f)
+		{
+			return false;
+		}
+
+		const float paneOffsetX			= (glm::dot(toPosition, RightVector) + originOffset * ((1.0f - primaryParallel) * a + (1.0f - secondaryParallel) * b)) / paneScale;
+		const float paneOffsetY			= glm::dot(toPosition, UpVector) / paneScale;
+
+		outInViewPercentageX			= (paneOffsetX / ViewPaneHalfSize.x + 1.0f) * 0.5f;
+		outInViewPercentageY			= (paneOffsetY / ViewPaneHalfSize.y + 1.0f) * 0.5f;
+		return outInViewPercentageX >= 0.0f && outInViewPercentageX <= 1.0f && outInViewPercentageY >= 0.0f && outInViewPercentageY <= 1.0f;
+	}
+
+	//////////////////////////////////////////////////////////////////////////
+
 	inline void MoveLocal(VectorType localOffset) 
 	{
 		Position += localOffset;
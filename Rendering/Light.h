@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Rendering/CUDATypes.h"
+#include "MathLib/MathLib.h"
 
 template <typename VectorType>
 struct A_CPUGPU_ALIGN(32) Light 
@@ -9,13 +10,19 @@ struct A_CPUGPU_ALIGN(32) Light
 
 	VectorType	Position;
 	float		Radius;
+	float		AreaRadius;		// < Size of the light hypersphere, used by stochastic shadows. Radius only scales the intensity.
+	float		Intensity;
+	bool		CastsShadows;
 
 	//////////////////////////////////////////////////////////////////////////
 
-	void Initialize(const VectorType& position, const float radius)
+	void Initialize(const VectorType& position, const float radius, const float areaRadius, const float intensity = 1.0f, const bool castsShadows = true)
 	{
-		Position	= position;
-		Radius		= radius;
+		Position		= position;
+		Radius			= radius;
+		AreaRadius		= areaRadius;
+		Intensity		= intensity;
+		CastsShadows	= castsShadows;
 	}
 
 	//////////////////////////////////////////////////////////////////////////
@@ -24,6 +31,50 @@ struct A_CPUGPU_ALIGN(32) Light
 	{
 		return Position;
 	}
+
+	// Unoccluded contribution of the light at the given position. Used to cull lights and to rank them for shadow rays.
+	A_CUDA_CPUGPU float GetImportance(const VectorType& position) const
+	{
+		return Intensity * Math::Clamp01(Radius / glm::length(Position - position));
+	}
+
+	bool operator!=(const Light& other) const
+	{
+		return Position != other.Position || Radius != other.Radius || AreaRadius != other.AreaRadius || Intensity != other.Intensity || CastsShadows != other.CastsShadows;
+	}
 };
 
+//////////////////////////////////////////////////////////////////////////
+
+// The first light is the key light. Only it uses the shadow grid, reduced shadow rates and stochastic shadows, the others are evaluated per pixel.
+template <typename VectorType>
+struct LightList
+{
+	static constexpr int MAX_LIGHT_COUNT = 8;
+
+	Light<VectorType>	Lights[MAX_LIGHT_COUNT];
+	int					LightCount = 0;
+
+	//////////////////////////////////////////////////////////////////////////
 
+	A_CUDA_CPUGPU const Light<VectorType>& GetKeyLight() const
+	{
+		return Lights[0];
+	}
+
+	bool operator!=(const LightList& other) const
+	{
+		if (LightCount != other.LightCount)
+		{
+			return true;
+		}
+		for (int i = 0; i < LightCount; i++)
+		{
+			if (Lights[i] != other.Lights[i])
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+};
@@ -1,6 +1,8 @@
 #pragma once
 #include "glm/ext/vector_int2.hpp"
 
+#include "Rendering/CUDATypes.h"
+
 enum QuiltConfiguration
 {
 	_16_singleView,
@@ -30,6 +32,46 @@ static const char* s_QuiltConfigurationsNames[(int) QuiltConfiguration::Count] =
 
 //////////////////////////////////////////////////////////////////////////
 
+constexpr unsigned int MAX_VIEW_COUNT = 64;		// < Largest supported quilt is 5x9 = 45 views.
+
+// Returns where a view lies inside the view cone, in [0, 1).
+A_CUDA_CPUGPU inline float GetViewPercentage(const unsigned int viewID, const unsigned int viewCount)
+{
+	return (viewCount == 1) ? 0.5f : viewID / static_cast<float>(viewCount);
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+// Quality settings for a single view of the quilt.
+// Views are not rendered into the quilt directly, but into a tightly packed view atlas, which is upscaled into the quilt on present.
+struct ViewQualityData
+{
+	unsigned int	ResolutionShift		= 0;		// < The view is rendered at (ViewDimensions >> ResolutionShift) pixels.
+	float			MaxStepsFactor		= 1.0f;		// < Scales MAX_STEPS of the primary marcher.
+	bool			ShadowsEnabled		= true;		// < If false, hits are lit as if they were not occluded.
+
+	glm::ivec2		AtlasDimensions		= {0, 0};
+	unsigned int	AtlasOffset			= 0;		// < Index of the first pixel of this view in the view atlas.
+};
+
+// Outer views are seen at steep angles through the lenticular, so they get less resolution and quality.
+// A tier is used if the distance of the view to the center of the view cone (in [0, 1]) is at least MinDistanceToCenter.
+struct ViewLevelOfDetailTier
+{
+	float			MinDistanceToCenter;
+	unsigned int	ResolutionShift;
+	float			MaxStepsFactor;
+	bool			ShadowsEnabled;
+};
+
+static const ViewLevelOfDetailTier s_ViewLevelOfDetailTiers[] = {
+	{0.00f, 0, 1.00f, true},
+	{0.50f, 1, 0.75f, true},
+	{0.80f, 2, 0.50f, false},
+};
+
+//////////////////////////////////////////////////////////////////////////
+
 struct QuiltConfigurationData
 {
 	QuiltConfigurationData() = default;
@@ -44,7 +86,46 @@ struct QuiltConfigurationData
 		UsedTextureDimensions	= {ViewDimensions.x * views.x, ViewDimensions.y * views.y};
 
 		assert(fmod(ViewDimensions.x, TileSize.x) == 0.0f && fmod(ViewDimensions.y, TileSize.y) == 0.0f);
+		assert(ViewCount <= MAX_VIEW_COUNT);
+
+		InitializeViewQualities();
 	}
+
+	void InitializeViewQualities()
+	{
+		AtlasPixelCount = 0;
+		for (unsigned int viewID = 0; viewID < ViewCount; viewID++)
+		{
+			const float distanceToCenter	= std::abs(GetViewPercentage(viewID, ViewCount) - 0.5f) * 2.0f;
+
+			ViewLevelOfDetailTier tier		= s_ViewLevelOfDetailTiers[0];
+			if (UseViewLevelOfDetail)
+			{
+				for (const ViewLevelOfDetailTier& candidate : s_ViewLevelOfDetailTiers)
+				{
+					if (distanceToCenter >= candidate.MinDistanceToCenter)
+					{
+						tier = candidate;
+					}
+				}
+			}
+
+			ViewQualityData& view	= ViewQualities[viewID];
+			view.ResolutionShift	= tier.ResolutionShift;
+			view.MaxStepsFactor		= tier.MaxStepsFactor;
+			view.ShadowsEnabled		= tier.ShadowsEnabled;
+
+			// Round up, so that every pixel of the quilt has a source pixel in the atlas.
+			const int scale			= 1 << tier.ResolutionShift;
+			view.AtlasDimensions	= {(ViewDimensions.x + scale - 1) / scale, (ViewDimensions.y + scale - 1) / scale};
+			view.AtlasOffset		= AtlasPixelCount;
+
+			AtlasPixelCount		   += view.AtlasDimensions.x * view.AtlasDimensions.y;
+		}
+	}
+
+	// Size of the atlas if every view is rendered at full resolution.
+	unsigned int GetMaxAtlasPixelCount() const { return ViewCount * ViewDimensions.x * ViewDimensions.y; }
 		
 	glm::ivec2		TextureDimensions;
 	glm::ivec2		UsedTextureDimensions;
@@ -52,4 +133,8 @@ struct QuiltConfigurationData
 	glm::ivec2		ViewDimensions;
 	unsigned int	ViewCount;
 	glm::ivec2		TileSize;
+
+	bool			UseViewLevelOfDetail	= false;
+	ViewQualityData	ViewQualities[MAX_VIEW_COUNT];
+	unsigned int	AtlasPixelCount			= 0;
 };
\ No newline at end of file
@@ -0,0 +1,91 @@
+#pragma once
+
+// Generated by Tools/SceneCodeGenerator from HyperCube.scene. Do not edit, regenerate instead.
+
+#include "Rendering/Scenes/Scene.h"
+
+#include "MathLib/MathLib.h"
+#include "MathLib/SignedDistanceFields/SignedDistanceField.h"
+
+class A_CPUGPU_ALIGN(16) SceneHyperCubeGenerated : public Scene<glm::vec4>
+{
+public:
+	using N = glm::vec4;
+
+	void Init() {}
+	void UnInit() {}
+
+	//////////////////////////////////////////////////////////////////////////
+
+	A_CUDA_CPUGPU float EvaluateDistance(const glm::vec4& position) const
+	{
+		const glm::vec4 p1 = position - m_Translation;
+		const glm::vec4 p2 = m_Transformation * p1;
+		const glm::vec4 q0 = Math::Abs(p2) - glm::vec4(14.0f, 14.0f, 14.0f, 14.0f);
+		const float d0 = Math::Min(Math::MaxComponent(q0), 0.0f) + Math::Length(Math::Max(q0, glm::vec4(0.0f)));
+		return d0;
+	}
+
+	//////////////////////////////////////////////////////////////////////////
+
+	A_CUDA_CPUGPU glm::vec4 GetLocalSamplePosition(const glm::vec4& position) const
+	{
+		const glm::vec4 p1 = position - m_Translation;
+		const glm::vec4 p2 = m_Transformation * p1;
+		return p2;
+	}
+
+	//////////////////////////////////////////////////////////////////////////
+
+	// Material id of the primitive that is closest to the position.
+	A_CUDA_CPUGPU int GetMaterialID(const glm::vec4& position) const
+	{
+		return 0;
+	}
+
+	//////////////////////////////////////////////////////////////////////////
+
+	A_CUDA_CPUGPU glm::vec4 EvaluateNormal(const glm::vec4& position) const
+	{
+		return Math::SampleNormal(*this, position);
+	}
+
+	//////////////////////////////////////////////////////////////////////////
+
+	A_CUDA_CPUGPU glm::vec4 EvaluateToSurfaceVector(const glm::vec4& position, float& outDistance) const
+	{
+		return Math::EvaluateToSurfaceVector(*this, position, outDistance);
+	}
+
+	//////////////////////////////////////////////////////////////////////////
+
+	A_CUDA_CPUGPU glm::vec4 EvaluateToSurfaceVectorZW(const glm::vec4& position, float& outDistance) const
+	{
+		return Math::EvaluateToSurfaceVectorZW(*this, position, outDistance);
+	}
+
+	//////////////////////////////////////////////////////////////////////////
+
+	A_CUDA_CPUGPU glm::vec4 EvaluateToSurfaceVectorZWFromDistance(const glm::vec4& position, const float distance) const
+	{
+		return Math::EvaluateToSurfaceVectorZWFromDistance(*this, position, distance);
+	}
+
+	//////////////////////////////////////////////////////////////////////////
+
+	Math::Hypershere GetBoundingHypersphere() const
+	{
+		return Math::Hypershere(m_Translation, 28.0f);
+	}
+
+	//////////////////////////////////////////////////////////////////////////
+
+	A_CUDA_CPUGPU void SetTranslation(const glm::vec4& value) { m_Translation = value; }
+	A_CUDA_CPUGPU const glm::vec4& GetTranslation() const { return m_Translation; }
+	A_CUDA_CPUGPU void SetTransformation(const glm::mat4& value) { m_Transformation = value; }
+	A_CUDA_CPUGPU const glm::mat4& GetTransformation() const { return m_Transformation; }
+
+private:
+	glm::vec4 m_Translation = glm::vec4(0.0f, 0.0f, 0.0f, 0.0f);
+	glm::mat4 m_Transformation = glm::mat4(1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f);
+};
@@ -1,7 +1,9 @@
 #pragma once
 
 #include <MathLib\MathLib.h>
+#include <algorithm>
 #include <type_traits>
+#include <vector>
 
 namespace SDFFactory
 {
@@ -16,12 +18,12 @@ namespace SDFFactory
 	{	
 
 		auto sdfVert						= Math::SDFHyperSphere(SIZE);
-		auto sdfVertT						= Math::SDFTranslation<decltype(sdfVert)>(std::move(sdfVert), Math::Vector4(0, 0, 0, 0));
-		auto sdfAllVerts					= Math::SDFFiniteRepetition<decltype(sdfVertT)>(std::move(sdfVertT), glm::vec4(SPACE, SPACE, SPACE, SPACE), glm::vec4(SPAN, SPAN, SPAN, SPAN));
+		auto sdfAllVerts					= Math::SDFFiniteRepetition<decltype(sdfVert)>(std::move(sdfVert), glm::vec4(SPACE, SPACE, SPACE, SPACE), glm::vec4(SPAN, SPAN, SPAN, SPAN));
+		auto sdfAllVertsBounded				= Math::SDFBounded<decltype(sdfAllVerts)>(std::move(sdfAllVerts), glm::vec4(0.0f), glm::vec4(SPACE * SPAN + SIZE), SIZE);
 
 		glm::mat4 vertsTransformation		= glm::identity<glm::mat4>();
-		auto sdfVertsTransformation			= Math::SDFTransformation4x4<decltype(sdfAllVerts)>(std::move(sdfAllVerts), vertsTransformation);
-		auto sdfVertsTranslation			= Math::SDFTranslation<decltype(sdfVertsTransformation)>(std::move(sdfVertsTransformation), glm::vec4());
+		auto sdfVertsTransformation			= Math::MakeTransformation(std::move(sdfAllVertsBounded), vertsTransformation);
+		auto sdfVertsTranslation			= Math::MakeTranslation(std::move(sdfVertsTransformation), glm::vec4(0, 0, 0, 0));	// < Fused into one SDFAffine
 
 		//////////////////////////////////////////////////////////////////////////
 
@@ -35,21 +37,21 @@ namespace SDFFactory
 		auto sdfCube						= Math::SDFBox<glm::vec4>(SIZE * 2 * glm::vec4(1, 1, 1, 1));
 
 		glm::mat4 vertsTransformation		= glm::identity<glm::mat4>();
-		auto sdfVertsTransformation			= Math::SDFTransformation4x4<decltype(sdfCube)>(std::move(sdfCube), vertsTransformation);
-		auto sdfVertsTranslation			= Math::SDFTranslation<decltype(sdfVertsTransformation)>(std::move(sdfVertsTransformation), glm::vec4(0, 0, 0, 0));
+		auto sdfVertsTransformation			= Math::MakeTransformation(std::move(sdfCube), vertsTransformation);
+		auto sdfVertsTranslation			= Math::MakeTranslation(std::move(sdfVertsTransformation), glm::vec4(0, 0, 0, 0));	// < Fused into one SDFAffine
 
 		auto sdfFloor						= Math::SDFBox<glm::vec4>(glm::vec4(40, 2, 400, 10));
-		auto sdfFloorTranslation			= Math::SDFTranslation<decltype(sdfFloor)>(std::move(sdfFloor), glm::vec4(0, -30, 100, 0));
+		auto sdfFloorTranslation			= Math::MakeTranslation(std::move(sdfFloor), glm::vec4(0, -30, 100, 0));
 
-		auto sdfBoolean						= Math::SDFUnion<Math::SDFTranslation<Math::SDFTransformation4x4<Math::SDFBox<glm::vec4>>>, 
+		// The union is never moved, so it does not get a (zero) translation of its own.
+		auto sdfBoolean						= Math::SDFUnion<Math::SDFAffine<Math::SDFBox<glm::vec4>>, 
 															 Math::SDFTranslation<Math::SDFBox<glm::vec4>>> 
 															 (std::move(sdfVertsTranslation), std::move(sdfFloorTranslation));
-		auto sdfBooleanTranslation			= Math::SDFTranslation<decltype(sdfBoolean)>(std::move(sdfBoolean), glm::vec4(0, 0, 0, 0));
 
 		//////////////////////////////////////////////////////////////////////////
 
 		// The new operator of SDFs is overwritten to be allocated by CUDA Managed	
-		return new decltype(sdfBooleanTranslation)(std::move(sdfBooleanTranslation)); // < Move construct the sdf into our SDF Base pointer.
+		return new decltype(sdfBoolean)(std::move(sdfBoolean)); // < Move construct the sdf into our SDF Base pointer.
 	}
 
 	auto inline CreateSDF_HyperSphere()
@@ -58,8 +60,8 @@ namespace SDFFactory
 		auto sdfCube						= Math::SDFHyperSphere(50.0f);
 		
 		glm::mat4 vertsTransformation		= glm::identity<glm::mat4>();
-		auto sdfVertsTransformation			= Math::SDFTransformation4x4<decltype(sdfCube)>(std::move(sdfCube), vertsTransformation);
-		auto sdfVertsTranslation			= Math::SDFTranslation<decltype(sdfVertsTransformation)>(std::move(sdfVertsTransformation), glm::vec4());
+		auto sdfVertsTransformation			= Math::MakeTransformation(std::move(sdfCube), vertsTransformation);
+		auto sdfVertsTranslation			= Math::MakeTranslation(std::move(sdfVertsTransformation), glm::vec4(0, 0, 0, 0));	// < Fused into one SDFAffine
 
 		//////////////////////////////////////////////////////////////////////////
 
@@ -67,6 +69,99 @@ namespace SDFFactory
 		return new decltype(sdfVertsTranslation)(std::move(sdfVertsTranslation)); // < Move construct the sdf into our SDF Base pointer.
 	}
 
+	// Runtime counterpart of the cube in CreateSDF_HyperCube, recorded into an SDFProgram instead of a template tree.
+	// The floor is left out, as the scene only ever evaluates the cube (see SceneHyperPlayground::EvaluateCubeDistance).
+	inline Math::SDFProgram* CreateProgram_HyperCube(Math::SDFParameterHandle& outTranslation, Math::SDFParameterHandle& outTransformation)
+	{
+		Math::SDFProgram* program = new Math::SDFProgram();	// < Allocated by CUDA Managed
+		Math::SDFProgramBuilder builder(*program);
+
+		outTranslation			= builder.PushTranslation(glm::vec4(0, 0, 0, 0));
+		outTransformation		= builder.PushTransformation(glm::identity<glm::mat4>());
+		builder.AddBox(SIZE * 2 * glm::vec4(1, 1, 1, 1));
+		builder.PopPosition();
+		builder.PopPosition();
+
+		assert(builder.IsComplete());
+		return program;
+	}
+
+	// Small boxes and hyperspheres scattered around the hypercube, for scenes with many objects.
+	// Uses a fixed seed, so the same count always gives the same objects.
+	inline std::vector<Math::SDFHierarchyLeaf> CreateLeaves_ObjectField(const int count)
+	{
+		constexpr float FIELD_EXTENTS[4]	= {150.0f, 40.0f, 150.0f, 60.0f};
+		constexpr float FIELD_OFFSET_Y		= 20.0f;
+		constexpr float CUBE_CLEARANCE		= 45.0f;
+
+		unsigned int seed	= 1337u;
+		auto random01		= [&seed]() 
+		{
+			seed = seed * 1664525u + 1013904223u;
+			return (seed >> 8) / 16777216.0f;
+		};
+
+		std::vector<Math::SDFHierarchyLeaf> leaves;
+		leaves.reserve(count);
+		while (static_cast<int>(leaves.size()) < count)
+		{
+			glm::vec4 position;
+			for (int axis = 0; axis < 4; axis++)
+			{
+				position[axis] = (random01() * 2.0f - 1.0f) * FIELD_EXTENTS[axis];
+			}
+			position.y += FIELD_OFFSET_Y;
+
+			// Keep the hypercube itself free.
+			if (glm::length(position) < CUBE_CLEARANCE)
+			{
+				continue;
+			}
+
+			const glm::mat4 rotation	= Math::RotXW(random01() * glm::two_pi<float>()) * 
+										  Math::RotYZ(random01() * glm::two_pi<float>()) * 
+										  Math::RotXY(random01() * glm::two_pi<float>());
+			const float size			= 2.0f + 2.0f * static_cast<int>(random01() * 3.0f);	// < 2, 4 or 6, so that instances can share prototypes
+
+			Math::SDFHierarchyLeaf leaf;
+			leaf.Primitive	= (leaves.size() % 2 == 0) ? Math::SDFOpCode::Box : Math::SDFOpCode::HyperSphere;
+			leaf.Parameter	= glm::vec4(size);
+			leaf.MaterialID	= static_cast<int>(leaves.size() % 4);
+			leaf.SetTranslationAndTransformation(position, rotation);
+			leaves.push_back(leaf);
+		}
+
+		return leaves;
+	}
+
+	// The object field of CreateLeaves_ObjectField as instances. Objects with the same primitive and size share one prototype.
+	inline std::vector<Math::SDFInstance> CreateInstances_ObjectField(const int count, std::vector<Math::SDFInstancePrototype>& outPrototypes)
+	{
+		const std::vector<Math::SDFHierarchyLeaf> leaves = CreateLeaves_ObjectField(count);
+
+		outPrototypes.clear();
+		std::vector<Math::SDFInstance> instances;
+		instances.reserve(leaves.size());
+		for (const Math::SDFHierarchyLeaf& leaf : leaves)
+		{
+			auto prototype = std::find_if(outPrototypes.begin(), outPrototypes.end(), [&leaf](const Math::SDFInstancePrototype& p) { return p.Primitive == leaf.Primitive && p.Parameter == leaf.Parameter; });
+			if (prototype == outPrototypes.end())
+			{
+				outPrototypes.push_back({leaf.Primitive, leaf.Parameter});
+				prototype = outPrototypes.end() - 1;
+			}
+
+			Math::SDFInstance instance;
+			instance.Transformation	= leaf.Transformation;
+			instance.Offset			= leaf.Offset;
+			instance.PrototypeID	= static_cast<int>(prototype - outPrototypes.begin());
+			instance.MaterialID		= leaf.MaterialID;
+			instances.push_back(instance);
+		}
+
+		return instances;
+	}
+
 	// #SDFType: using SDF_HyperCubeSpheres_ptr_t = std::invoke_result<decltype(&SDFFactory::CreateSDF_HyperCubeSpheres)>::type;
 
 	//////////////////////////////////////////////////////////////////////////
@@ -82,10 +177,11 @@ namespace SDFFactory
 		auto sdfPrimitive2Transformed		= Math::SDFTransformation4x4<decltype(sdfPrimitive2Translated)>(std::move(sdfPrimitive2Translated), transformation);
 
 		auto sdfCombination					= Math::SDFSmoothUnion<decltype(sdfPrimitive2Transformed), decltype(sdfPrimitive1Translated)>(std::move(sdfPrimitive2Transformed), std::move(sdfPrimitive1Translated), 10.f);
+		auto sdfCombinationBounded			= Math::SDFBounded<decltype(sdfCombination)>(std::move(sdfCombination), glm::vec3(0.0f), 80.0f, 10.0f);	// < Both primitives plus the smoothing
 
 		//////////////////////////////////////////////////////////////////////////
 
-		return new decltype(sdfCombination)(std::move(sdfCombination)); // < Move construct the sdf into our SDF Base pointer.
+		return new decltype(sdfCombinationBounded)(std::move(sdfCombinationBounded)); // < Move construct the sdf into our SDF Base pointer.
 	}
 
 	// #SDFType: using SDF_3DPlayGround_ptr_t = std::invoke_result<decltype(&CreateSDF_3DPlayGround)>::type;	
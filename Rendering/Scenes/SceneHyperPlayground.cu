@@ -3,6 +3,7 @@
 #include "Rendering/Scenes/SceneHyperPlayground.h"
 #include "Rendering/Scenes/SceneTypes.h"
 #include "Rendering/Scenes/SDFFactory.h"
+#include "Rendering/CUDAInterface.h"
 
 #include "Options/Configuration.h"
 
@@ -13,11 +14,13 @@
 
 void SceneHyperPlayground::Update(Configuration& config) {	
 	auto time = Application::s_Instance->GetTimeSinceStartupMyS();
+	bool isAnimated = false;
 	for (int i = 0; i < 6; i++)
 	{
 		if (config.SceneAnimateRotations[i]) 
 		{
 			config.SceneSliderRotations[i] = fmod((time.count() / 1000000.0f * config.SceneSpeed), glm::two_pi<float>());
+			isAnimated = true;
 		}
 	}
 
@@ -30,43 +33,286 @@ void SceneHyperPlayground::Update(Configuration& config) {
 
 	glm::vec4 translation	= {config.SceneSliderPositions[0], config.SceneSliderPositions[1], config.SceneSliderPositions[2], config.SceneSliderPositions[3]};
 
-	m_SDF_Cube->GetSDF().SetTransformationMatrix(transformation);
-	m_SDF_Cube->SetTranslationVector(m_BaseTranslation + translation);
+	m_SDF_Cube->SetTranslationAndTransformation(m_BaseTranslation + translation, transformation);
+	m_CubePolytope = Math::ConvexPolytope::FromBox(m_BaseTranslation + translation, transformation, m_SDF_Cube->GetSDF().GetExtents());
+
+	m_Program->SetParameter(m_ProgramTransformation, transformation);
+	m_Program->SetParameter(m_ProgramTranslation, m_BaseTranslation + translation);
+	m_Generated.SetTransformation(transformation);
+	m_Generated.SetTranslation(m_BaseTranslation + translation);
+
+	m_Evaluator = static_cast<SceneEvaluator>(config.SceneEvaluatorID);
+
+	const SceneObjectAcceleration objectAcceleration = static_cast<SceneObjectAcceleration>(config.SceneObjectAccelerationID);
+	bool objectsRebuilt = false;
+	if (config.SceneObjectCount != m_ObjectCount || objectAcceleration != m_ObjectAcceleration)
+	{
+		m_Objects->Release();
+		m_Instances->Release();
+		delete[] mh_ObjectBaseLeaves;
+		mh_ObjectBaseLeaves = nullptr;
+
+		if (objectAcceleration == SceneObjectAcceleration::InstanceGrid)
+		{
+			std::vector<Math::SDFInstancePrototype> prototypes;
+			const std::vector<Math::SDFInstance> instances = SDFFactory::CreateInstances_ObjectField(config.SceneObjectCount, prototypes);
+			m_Instances->Build(prototypes.data(), static_cast<int>(prototypes.size()), instances.data(), static_cast<int>(instances.size()));
+		}
+		else
+		{
+			const std::vector<Math::SDFHierarchyLeaf> leaves = SDFFactory::CreateLeaves_ObjectField(config.SceneObjectCount);
+			mh_ObjectBaseLeaves = new Math::SDFHierarchyLeaf[leaves.size()];
+			std::copy(leaves.begin(), leaves.end(), mh_ObjectBaseLeaves);
+			m_Objects->Build(leaves.data(), static_cast<int>(leaves.size()));
+		}
+
+		m_ObjectCount			= config.SceneObjectCount;
+		m_ObjectAcceleration	= objectAcceleration;
+		m_ObjectsMoved			= true;
+		objectsRebuilt			= true;
+	}
+
+	// While the scene is animated, the objects of the hierarchy orbit the cube, each at its own speed.
+	const bool objectsOrbit = isAnimated && m_ObjectCount > 0 && m_ObjectAcceleration == SceneObjectAcceleration::Hierarchy;
+	if (objectsOrbit)
+	{
+		m_ObjectOrbitTime	= time.count() / 1000000.0f * config.SceneSpeed;
+		m_ObjectsMoved		= true;
+	}
+
+	UpdateObjects(m_BaseTranslation + translation, transformation);
+
+	// Orbiting objects are not static in the cube's frame, so they only use the brick cache while they rest.
+	const bool useObjectCache = config.SceneUseBrickCache && !objectsOrbit;
+	if (objectsRebuilt || useObjectCache != m_UseObjectCache)
+	{
+		m_UseObjectCache	= useObjectCache;
+		m_ObjectFrameBounds	= (m_ObjectAcceleration == SceneObjectAcceleration::InstanceGrid) ? m_Instances->GetBoundingHypersphere() : m_Objects->GetBoundingHypersphere();
+		SetObjectCache(mcm_ObjectCache);
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void SceneHyperPlayground::UpdateObjects(const glm::vec4& translation, const glm::mat4& transformation)
+{
+	// Both structures are built in the cube's frame, so moving the cube only moves the samples into that frame: T * (p - t)
+	m_ObjectTranslation		= translation;
+	m_ObjectTransformation	= transformation;
+
+	if (m_ObjectCount == 0 || m_ObjectAcceleration != SceneObjectAcceleration::Hierarchy || !m_ObjectsMoved)
+	{
+		return;
+	}
+
+	// Every object orbits the cube's center in the XZ plane (RotYW keeps Y and W fixed), the inner ones faster.
+	// The field shears apart over time, so the bounds get looser with every refit until the hierarchy rebuilds itself.
+	constexpr float ORBIT_REFERENCE_RADIUS = 50.0f;
+	for (int i = 0; i < m_ObjectCount; i++)
+	{
+		const Math::SDFHierarchyLeaf& baseLeaf	= mh_ObjectBaseLeaves[i];
+		const glm::vec4 baseCenter				= baseLeaf.GetBoundsCenter();
+		const float orbitRadius					= Math::Max(glm::length(glm::vec2(baseCenter.x, baseCenter.z)), 1.0f);
+		const float angle						= m_ObjectOrbitTime * sqrtf(ORBIT_REFERENCE_RADIUS / orbitRadius);
+
+		// Rotating the object by R around the origin: local = M * (R^T * p) + b
+		Math::SDFHierarchyLeaf& leaf	= m_Objects->GetLeaf(i);
+		leaf.Transformation				= baseLeaf.Transformation * glm::transpose(Math::RotYW(angle));
+		leaf.Offset						= baseLeaf.Offset;
+	}
+
+	m_Objects->Refit();
+	m_ObjectsMoved = false;
+
+	const Math::Hypershere objectBounds = m_Objects->GetBoundingHypersphere();
+	m_BoundedObjects->SetBound(objectBounds.Origin, objectBounds.Radius);
 }
 
 //////////////////////////////////////////////////////////////////////////
 
 A_CUDA_CPUGPU float SceneHyperPlayground::EvaluateDistance(const glm::vec4& position) const
 {
-	return m_SDF_Cube->EvaluateDistance(position);
+	const float distance = EvaluateCubeDistance(position);
+	if (m_ObjectCount == 0)
+	{
+		return distance;
+	}
+
+	return Math::Min(distance, EvaluateObjectsDistance(position));
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+A_CUDA_CPUGPU float SceneHyperPlayground::EvaluateObjectsDistance(const glm::vec4& position) const
+{
+	const glm::vec4 framePosition = m_ObjectTransformation * (position - m_ObjectTranslation);
+
+	// Close to the surface, the interpolated distance is not precise enough for hits and normals.
+	float cachedDistance;
+	if (mcm_ObjectCache != nullptr && mcm_ObjectCache->TryEvaluateDistance(framePosition, cachedDistance) && cachedDistance > mcm_ObjectCache->VoxelSize)
+	{
+		return cachedDistance;
+	}
+
+	return EvaluateStaticObjectsDistance(framePosition);
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+A_CUDA_CPUGPU float SceneHyperPlayground::EvaluateStaticObjectsDistance(const glm::vec4& framePosition) const
+{
+	if (m_ObjectAcceleration == SceneObjectAcceleration::InstanceGrid)
+	{
+		return m_Instances->EvaluateDistance(framePosition);
+	}
+
+	return m_BoundedObjects->EvaluateDistance(framePosition);
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void SceneHyperPlayground::SetObjectCache(RenderVoxelBufferDataCUDA* const objectCache)
+{
+	mcm_ObjectCache = objectCache;
+	if (mcm_ObjectCache != nullptr)
+	{
+		mcm_ObjectCache->IsEnabled = m_UseObjectCache;
+		mcm_ObjectCache->Fit(m_UseObjectCache && m_ObjectCount > 0 ? m_ObjectFrameBounds : Math::Hypershere());
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+A_CUDA_CPUGPU glm::vec4 SceneHyperPlayground::GetObjectsLocalSamplePosition(const glm::vec4& position) const
+{
+	const glm::vec4 framePosition = m_ObjectTransformation * (position - m_ObjectTranslation);
+	if (m_ObjectAcceleration == SceneObjectAcceleration::InstanceGrid)
+	{
+		return m_Instances->GetLocalSamplePosition(framePosition);
+	}
+
+	return m_Objects->GetLocalSamplePosition(framePosition);
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+A_CUDA_CPUGPU float SceneHyperPlayground::EvaluateCubeDistance(const glm::vec4& position) const
+{
+	switch (m_Evaluator)
+	{
+		case SceneEvaluator::Program:	return m_Program->EvaluateDistance(position);
+		case SceneEvaluator::Generated:	return m_Generated.EvaluateDistance(position);
+		default:						return m_SDF_Cube->EvaluateDistance(position);
+	}
 }
 
 //////////////////////////////////////////////////////////////////////////
 
 A_CUDA_CPUGPU glm::vec4 SceneHyperPlayground::EvaluateNormal(const glm::vec4& position) const
 {
-	return Math::SampleNormal(*m_SDF_Cube, position);
+	if (m_ObjectCount > 0)
+	{
+		return Math::SampleNormal(*this, position);
+	}
+
+	switch (m_Evaluator)
+	{
+		case SceneEvaluator::Program:	return m_Program->SampleNormal(position);
+		case SceneEvaluator::Generated:	return m_Generated.EvaluateNormal(position);
+		default:						return Math::SampleNormal(*m_SDF_Cube, position);
+	}
 }
 
 //////////////////////////////////////////////////////////////////////////
 
 A_CUDA_CPUGPU glm::vec4 SceneHyperPlayground::GetLocalSamplePosition(const glm::vec4& position) const
 {
-	return m_SDF_Cube->GetLocalSamplePosition(position);
+	if (m_ObjectCount > 0 && EvaluateObjectsDistance(position) < EvaluateCubeDistance(position))
+	{
+		return GetObjectsLocalSamplePosition(position);
+	}
+
+	switch (m_Evaluator)
+	{
+		case SceneEvaluator::Program:	return m_Program->GetLocalSamplePosition(position);
+		case SceneEvaluator::Generated:	return m_Generated.GetLocalSamplePosition(position);
+		default:						return m_SDF_Cube->GetLocalSamplePosition(position);
+	}
 }
 
 //////////////////////////////////////////////////////////////////////////
 
 A_CUDA_CPUGPU glm::vec4 SceneHyperPlayground::EvaluateToSurfaceVectorZW(const glm::vec4& position, float& outDistance) const
 {
-	return Math::EvaluateToSurfaceVectorZW(*m_SDF_Cube, position, outDistance);
+	if (m_ObjectCount > 0)
+	{
+		return Math::EvaluateToSurfaceVectorZW(*this, position, outDistance);
+	}
+
+	switch (m_Evaluator)
+	{
+		case SceneEvaluator::Program:	return m_Program->EvaluateToSurfaceVectorZW(position, outDistance);
+		case SceneEvaluator::Generated:	return m_Generated.EvaluateToSurfaceVectorZW(position, outDistance);
+		default:						return Math::EvaluateToSurfaceVectorZW(*m_SDF_Cube, position, outDistance);
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+A_CUDA_CPUGPU glm::vec4 SceneHyperPlayground::EvaluateToSurfaceVectorZWFromDistance(const glm::vec4& position, const float distance) const
+{
+	if (m_ObjectCount > 0)
+	{
+		return Math::EvaluateToSurfaceVectorZWFromDistance(*this, position, distance);
+	}
+
+	switch (m_Evaluator)
+	{
+		case SceneEvaluator::Program:	return m_Program->EvaluateToSurfaceVectorZWFromDistance(position, distance);
+		case SceneEvaluator::Generated:	return m_Generated.EvaluateToSurfaceVectorZWFromDistance(position, distance);
+		default:						return Math::EvaluateToSurfaceVectorZWFromDistance(*m_SDF_Cube, position, distance);
+	}
 }
 
 //////////////////////////////////////////////////////////////////////////
 
 A_CUDA_CPUGPU glm::vec4 SceneHyperPlayground::EvaluateToSurfaceVector(const glm::vec4& position, float& outDistance) const
 {
-	return Math::EvaluateToSurfaceVector(*m_SDF_Cube, position, outDistance);
+	if (m_ObjectCount > 0)
+	{
+		return Math::EvaluateToSurfaceVector(*this, position, outDistance);
+	}
+
+	switch (m_Evaluator)
+	{
+		case SceneEvaluator::Program:	return m_Program->EvaluateToSurfaceVector(position, outDistance);
+		case SceneEvaluator::Generated:	return m_Generated.EvaluateToSurfaceVector(position, outDistance);
+		default:						return Math::EvaluateToSurfaceVector(*m_SDF_Cube, position, outDistance);
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+Math::Hypershere SceneHyperPlayground::GetBoundingHypersphere() const
+{
+	// The cube is only rotated, so the length of its extents bounds it in every orientation.
+	const Math::Hypershere cubeBounds = Math::Hypershere(m_SDF_Cube->GetTranslation(), glm::length(m_SDF_Cube->GetSDF().GetExtents()));
+	if (m_ObjectCount == 0)
+	{
+		return cubeBounds;
+	}
+
+	// Grow the cube bounds until they enclose the objects as well. T is a rotation, so its inverse is its transpose.
+	Math::Hypershere objectBounds	= (m_ObjectAcceleration == SceneObjectAcceleration::InstanceGrid) ? m_Instances->GetBoundingHypersphere() : m_Objects->GetBoundingHypersphere();
+	objectBounds.Origin				= glm::transpose(m_ObjectTransformation) * objectBounds.Origin + m_ObjectTranslation;
+	return Math::Hypershere(cubeBounds.Origin, Math::Max(cubeBounds.Radius, glm::length(objectBounds.Origin - cubeBounds.Origin) + objectBounds.Radius));
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+A_CUDA_CPUGPU bool SceneHyperPlayground::IntersectAnalytic(const Math::BiRay<glm::vec4>& biRay, const float maxDistance, Math::BiRayHit& outHit) const
+{
+	return Math::Intersects(biRay, m_CubePolytope, maxDistance, &outHit);
 }
 
 //////////////////////////////////////////////////////////////////////////
@@ -74,10 +320,19 @@ A_CUDA_CPUGPU glm::vec4 SceneHyperPlayground::EvaluateToSurfaceVector(const glm:
 void SceneHyperPlayground::Init()
 {
 	m_SDF				= SDFFactory::CreateSDF_HyperCube();
-	m_SDF_Plane			= m_SDF->GetSDF().GetRHS();
-	m_SDF_Cube			= m_SDF->GetSDF().GetLHS();
+	m_SDF_Plane			= m_SDF->GetRHS();
+	m_SDF_Cube			= m_SDF->GetLHS();
 
 	m_BaseTranslation	= m_SDF_Cube->GetTranslation();
+	m_CubePolytope		= Math::ConvexPolytope::FromBox(m_BaseTranslation, m_SDF_Cube->GetTransformationMatrix(), m_SDF_Cube->GetSDF().GetExtents());
+
+	m_Program			= SDFFactory::CreateProgram_HyperCube(m_ProgramTranslation, m_ProgramTransformation);
+	m_Objects			= new Math::SDFHierarchy();
+	m_Instances			= new Math::SDFInstances();
+
+	// Closer than the largest object to the bound, the traversal is likely to find a leaf anyway.
+	constexpr float OBJECT_BOUND_MARGIN = 6.0f;
+	m_BoundedObjects	= new Math::SDFBounded<const Math::SDFHierarchy&>(*m_Objects, glm::vec4(0.0f), 0.0f, OBJECT_BOUND_MARGIN);
 }
 
 //////////////////////////////////////////////////////////////////////////
@@ -85,4 +340,9 @@ void SceneHyperPlayground::Init()
 void SceneHyperPlayground::UnInit()
 {
 	delete m_SDF;
+	delete m_Program;
+	delete m_BoundedObjects;
+	delete m_Objects;
+	delete m_Instances;
+	delete[] mh_ObjectBaseLeaves;
 }
@@ -1,11 +1,14 @@
 #pragma once
 
 #include "Rendering/Scenes/Scene.h"
+#include "Rendering/Scenes/SceneTypes.h"
+#include "Rendering/Scenes/Generated/SceneHyperCubeGenerated.h"
 
 #include "MathLib/MathLib.h"
 #include "MathLib/SignedDistanceFields/SignedDistanceField.h"
 
 struct Configuration;
+struct RenderVoxelBufferDataCUDA;
 
 class A_CPUGPU_ALIGN(64) SceneHyperPlayground : public Scene<glm::vec4>
 {
@@ -20,12 +23,58 @@ public:
 	A_CUDA_CPUGPU glm::vec4 EvaluateNormal(const glm::vec4& position) const;
 	A_CUDA_CPUGPU glm::vec4 EvaluateToSurfaceVector(const glm::vec4& position, float& outDistance) const;
 	A_CUDA_CPUGPU glm::vec4 EvaluateToSurfaceVectorZW(const glm::vec4& position, float& outDistance) const;
+	A_CUDA_CPUGPU glm::vec4 EvaluateToSurfaceVectorZWFromDistance(const glm::vec4& position, const float distance) const;
 	A_CUDA_CPUGPU glm::vec4 GetLocalSamplePosition(const glm::vec4& position) const;
 
+	// Distance to the objects in the cube's frame. They only move in it while they orbit, otherwise they are static geometry for the brick cache.
+	A_CUDA_CPUGPU float EvaluateStaticObjectsDistance(const glm::vec4& framePosition) const;
+	void SetObjectCache(RenderVoxelBufferDataCUDA* const objectCache);
+
+	Math::Hypershere GetBoundingHypersphere() const;
+
+	// Without additional objects, the scene is only the cube, which is a convex polytope and can be intersected in closed form.
+	A_CUDA_CPUGPU bool IsAnalytic() const { return m_ObjectCount == 0; }
+	A_CUDA_CPUGPU bool IntersectAnalytic(const Math::BiRay<glm::vec4>& biRay, const float maxDistance, Math::BiRayHit& outHit) const;
+
 private:
-	Math::SDFTranslation<Math::SDFUnion<Math::SDFTranslation<Math::SDFTransformation4x4<Math::SDFBox<glm::vec4>>>,Math::SDFTranslation<Math::SDFBox<glm::vec4>>>>* m_SDF = nullptr;
+	A_CUDA_CPUGPU float EvaluateCubeDistance(const glm::vec4& position) const;
+	A_CUDA_CPUGPU float EvaluateObjectsDistance(const glm::vec4& position) const;
+	A_CUDA_CPUGPU glm::vec4 GetObjectsLocalSamplePosition(const glm::vec4& position) const;
+	void UpdateObjects(const glm::vec4& translation, const glm::mat4& transformation);
+
+	Math::SDFUnion<Math::SDFAffine<Math::SDFBox<glm::vec4>>,Math::SDFTranslation<Math::SDFBox<glm::vec4>>>* m_SDF = nullptr;
 	Math::SDFTranslation<Math::SDFBox<glm::vec4>>* m_SDF_Plane = nullptr;
-	Math::SDFTranslation<Math::SDFTransformation4x4<Math::SDFBox<glm::vec4>>>* m_SDF_Cube = nullptr;
+	Math::SDFAffine<Math::SDFBox<glm::vec4>>* m_SDF_Cube = nullptr;
+
+	// Other evaluators of the same cube, selected by SceneEvaluatorID.
+	Math::SDFProgram* m_Program = nullptr;
+	Math::SDFParameterHandle m_ProgramTranslation = 0;
+	Math::SDFParameterHandle m_ProgramTransformation = 0;
+	SceneHyperCubeGenerated m_Generated;
+	SceneEvaluator m_Evaluator = SceneEvaluator::Templates;
+
+	// Additional objects around the cube, see SceneObjectCount. Only the structure selected by m_ObjectAcceleration is built.
+	Math::SDFHierarchy* m_Objects = nullptr;
+	Math::SDFBounded<const Math::SDFHierarchy&>* m_BoundedObjects = nullptr;	// < Skips the traversal far away from the hierarchy's root bounds.
+	Math::SDFInstances* m_Instances = nullptr;
+	int m_ObjectCount = 0;
+	SceneObjectAcceleration m_ObjectAcceleration = SceneObjectAcceleration::Hierarchy;
+
+	// Both structures are built in the cube's frame and move with m_ObjectTranslation / m_ObjectTransformation as a whole.
+	// Leaves as created by the factory, before their orbit. Indexed like the leaf ids of m_Objects. Host only.
+	Math::SDFHierarchyLeaf* mh_ObjectBaseLeaves = nullptr;
+	float m_ObjectOrbitTime = 0.0f;
+	glm::vec4 m_ObjectTranslation = glm::vec4(0, 0, 0, 0);
+	glm::mat4 m_ObjectTransformation = glm::mat4(1.0f);
+	bool m_ObjectsMoved = false;
+
+	// Optional brick cache of the objects in the cube's frame, see SceneUseBrickCache.
+	RenderVoxelBufferDataCUDA* mcm_ObjectCache = nullptr;
+	Math::Hypershere m_ObjectFrameBounds;
+	bool m_UseObjectCache = false;
+
+	// Half-spaces of the cube as it is placed in m_SDF_Cube, see IntersectAnalytic.
+	Math::ConvexPolytope m_CubePolytope;
 
 	glm::vec4 m_BaseTranslation = glm::vec4(0, 0, 0, 0);
 };
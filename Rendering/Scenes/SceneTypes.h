@@ -5,3 +5,22 @@ enum class SceneID
 	PlayGround = 0,
 	HyperPlayGround = 1,
 };
+
+// How a scene evaluates its SDF. All evaluators describe the same geometry.
+enum class SceneEvaluator
+{
+	Templates	= 0,	// < Compile time template tree, see SDFFactory.
+	Program		= 1,	// < Runtime SDF program.
+	Generated	= 2,	// < Code emitted by Tools/SceneCodeGenerator from Rendering/Scenes/Descriptions.
+
+	Count		= 3
+};
+
+// How a scene accelerates its additional objects.
+enum class SceneObjectAcceleration
+{
+	Hierarchy		= 0,	// < Bounding hypersphere hierarchy, refit when the objects move.
+	InstanceGrid	= 1,	// < Prototype instances in a uniform grid, moved as a whole.
+
+	Count			= 2
+};
@@ -0,0 +1,872 @@
+// SceneCodeGenerator
+// Reads a scene description and emits a header with a flattened, specialized scene class.
+// Literal translations and transformations are folded into constants, identity nodes are dropped and the whole SDF tree becomes
+// straight line code. The emitted class has the same interface as the scenes behind RenderSceneDataCUDA.
+//
+// This is a standalone tool and not part of the Aurora project. Build it with any C++17 compiler, e.g.
+//	cl /std:c++17 /EHsc SceneCodeGenerator.cpp
+//	g++ -std=c++17 SceneCodeGenerator.cpp -o SceneCodeGenerator
+//
+// Usage: SceneCodeGenerator <input.scene> <output.h>
+//
+// Scene description
+// One statement per line, '#' starts a comment. The tree is written in post order, just like with Math::SDFProgramBuilder:
+// Position modifiers apply to everything until their matching 'pop', booleans combine the two most recent subtrees.
+//
+//	scene <ClassName>
+//	param <Name> vec4 <x y z w>					Runtime parameter, becomes a member with Set<Name> / Get<Name>.
+//	param <Name> mat4 identity | <16 floats>	Matrices are given column major.
+//	bounds <vec4> <radius>						Bounding hypersphere. The origin may be a vec4 parameter.
+//
+//	box <vec4> [material <id>]
+//	hypersphere <radius> [material <id>]
+//
+//	translate <vec4>
+//	transform <mat4>
+//	repeat <spacing vec4>
+//	repeat_finite <spacing vec4> <span vec4>
+//	pop
+//
+//	onion <thickness>
+//	union | intersection | subtraction
+//	smooth_union <k> | smooth_intersection <k> | smooth_subtraction <k>
+//
+// Wherever a vec4 or mat4 is expected, either a literal or the name of a parameter of that type can be given.
+
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+//////////////////////////////////////////////////////////////////////////
+
+namespace
+{
+	struct Matrix
+	{
+		float m[4][4] = {{1, 0, 0, 0}, {0, 1, 0, 0}, {0, 0, 1, 0}, {0, 0, 0, 1}};	// < [column][row], like glm
+
+		bool IsIdentity() const
+		{
+			for (int c = 0; c < 4; c++)
+				for (int r = 0; r < 4; r++)
+					if (m[c][r] != (c == r ? 1.0f : 0.0f)) return false;
+			return true;
+		}
+
+		Matrix operator*(const Matrix& rhs) const
+		{
+			Matrix result;
+			for (int c = 0; c < 4; c++)
+				for (int r = 0; r < 4; r++)
+				{
+					result.m[c][r] = 0.0f;
+					for (int k = 0; k < 4; k++) result.m[c][r] += m[k][r] * rhs.m[c][k];
+				}
+			return result;
+		}
+	};
+
+	struct Vector
+	{
+		float v[4] = {0, 0, 0, 0};
+
+		bool IsZero() const { return v[0] == 0.0f && v[1] == 0.0f && v[2] == 0.0f && v[3] == 0.0f; }
+
+		Vector operator+(const Vector& rhs) const { Vector r; for (int i = 0; i < 4; i++) r.v[i] = v[i] + rhs.v[i]; return r; }
+		Vector operator-(const Vector& rhs) const { Vector r; for (int i = 0; i < 4; i++) r.v[i] = v[i] - rhs.v[i]; return r; }
+	};
+
+	Vector operator*(const Matrix& lhs, const Vector& rhs)
+	{
+		Vector result;
+		for (int r = 0; r < 4; r++)
+			for (int k = 0; k < 4; k++) result.v[r] += lhs.m[k][r] * rhs.v[k];
+		return result;
+	}
+
+	//////////////////////////////////////////////////////////////////////////
+
+	std::string ToString(const float value)
+	{
+		char buffer[32];
+		snprintf(buffer, sizeof(buffer), "%.9g", value);
+		std::string result = buffer;
+		if (result.find_first_of(".einEIN") == std::string::npos) result += ".0";
+		return result + "f";
+	}
+
+	std::string ToString(const Vector& value)
+	{
+		return "glm::vec4(" + ToString(value.v[0]) + ", " + ToString(value.v[1]) + ", " + ToString(value.v[2]) + ", " + ToString(value.v[3]) + ")";
+	}
+
+	std::string ToString(const Matrix& value)
+	{
+		std::string result = "glm::mat4(";
+		for (int c = 0; c < 4; c++)
+			for (int r = 0; r < 4; r++)
+				result += ToString(value.m[c][r]) + ((c == 3 && r == 3) ? ")" : ", ");
+		return result;
+	}
+
+	//////////////////////////////////////////////////////////////////////////
+
+	enum class ValueType { Vec4, Mat4 };
+
+	struct Parameter
+	{
+		std::string	Name;
+		ValueType	Type;
+		Vector		DefaultVector;
+		Matrix		DefaultMatrix;
+	};
+
+	// Either a literal or a reference to a runtime parameter.
+	struct Value
+	{
+		std::string	Parameter;
+		Vector		VectorValue;
+		Matrix		MatrixValue;
+
+		bool IsParameter() const { return !Parameter.empty(); }
+		std::string MemberName() const { return "m_" + Parameter; }
+	};
+
+	enum class OpCode
+	{
+		Box, HyperSphere,
+		Translate, Transform, Repeat, RepeatFinite, Pop,
+		Onion, Union, Intersection, Subtraction, SmoothUnion, SmoothIntersection, SmoothSubtraction,
+	};
+
+	struct Statement
+	{
+		OpCode	Op;
+		Value	A;
+		Value	B;
+		float	Scalar		= 0.0f;
+		int		Material	= 0;
+		int		Line		= 0;
+	};
+
+	struct SceneDescription
+	{
+		std::string				ClassName;
+		std::vector<Parameter>	Parameters;
+		std::vector<Statement>	Statements;
+		Value					BoundsOrigin;
+		float					BoundsRadius = -1.0f;
+
+		const Parameter* FindParameter(const std::string& name) const
+		{
+			for (const Parameter& parameter : Parameters)
+				if (parameter.Name == name) return &parameter;
+			return nullptr;
+		}
+	};
+
+	//////////////////////////////////////////////////////////////////////////
+	// Parsing
+	//////////////////////////////////////////////////////////////////////////
+
+	class Parser
+	{
+	public:
+		explicit Parser(SceneDescription& scene) : m_Scene(scene) {}
+
+		bool Parse(std::istream& input)
+		{
+			std::string line;
+			while (std::getline(input, line))
+			{
+				m_Line++;
+				const size_t comment = line.find('#');
+				if (comment != std::string::npos) line.erase(comment);
+
+				std::istringstream stream(line);
+				m_Tokens.clear();
+				m_Cursor = 0;
+				for (std::string token; stream >> token;) m_Tokens.push_back(token);
+
+				if (!m_Tokens.empty() && !ParseStatement())
+				{
+					return false;
+				}
+			}
+
+			if (m_Scene.ClassName.empty())	return Error("Missing 'scene <ClassName>'");
+			if (m_Scene.BoundsRadius < 0)	return Error("Missing 'bounds <origin> <radius>'");
+			if (m_PositionDepth != 0)		return Error("Missing 'pop' for a position modifier");
+			if (m_DistanceDepth != 1)		return Error("The scene needs to combine into exactly one SDF, add booleans");
+			return true;
+		}
+
+	private:
+
+		bool Error(const char* message) const
+		{
+			printf("Error (line %i): %s\n", m_Line, message);
+			return false;
+		}
+
+		bool HasToken() const { return m_Cursor < m_Tokens.size(); }
+		const std::string& NextToken() { return m_Tokens[m_Cursor++]; }
+
+		bool ReadFloat(float& outValue)
+		{
+			if (!HasToken()) return Error("Expected a number");
+			const std::string& token = NextToken();
+			char* end = nullptr;
+			outValue = std::strtof(token.c_str(), &end);
+			return (*end == '\0') || Error("Expected a number");
+		}
+
+		bool ReadVector(Value& outValue)
+		{
+			if (HasToken())
+			{
+				const Parameter* parameter = m_Scene.FindParameter(m_Tokens[m_Cursor]);
+				if (parameter != nullptr)
+				{
+					if (parameter->Type != ValueType::Vec4) return Error("Expected a vec4 parameter");
+					outValue.Parameter = NextToken();
+					return true;
+				}
+			}
+
+			for (int i = 0; i < 4; i++)
+			{
+				if (!ReadFloat(outValue.VectorValue.v[i])) return false;
+			}
+			return true;
+		}
+
+		bool ReadMatrix(Value& outValue)
+		{
+			if (HasToken())
+			{
+				const Parameter* parameter = m_Scene.FindParameter(m_Tokens[m_Cursor]);
+				if (parameter != nullptr)
+				{
+					if (parameter->Type != ValueType::Mat4) return Error("Expected a mat4 parameter");
+					outValue.Parameter = NextToken();
+					return true;
+				}
+
+				if (m_Tokens[m_Cursor] == "identity")
+				{
+					NextToken();
+					outValue.MatrixValue = Matrix();
+					return true;
+				}
+			}
+
+			for (int c = 0; c < 4; c++)
+				for (int r = 0; r < 4; r++)
+					if (!ReadFloat(outValue.MatrixValue.m[c][r])) return false;
+			return true;
+		}
+
+		bool ReadMaterial(Statement& statement)
+		{
+			if (!HasToken()) return true;
+			if (NextToken() != "material") return Error("Expected 'material <id>'");
+
+			float material = 0.0f;
+			if (!ReadFloat(material)) return false;
+			statement.Material = static_cast<int>(material);
+			return true;
+		}
+
+		//////////////////////////////////////////////////////////////////////////
+
+		bool ParseStatement()
+		{
+			const std::string keyword = NextToken();
+
+			Statement statement;
+			statement.Line = m_Line;
+
+			if (keyword == "scene")
+			{
+				if (!HasToken()) return Error("Expected a class name");
+				m_Scene.ClassName = NextToken();
+			}
+			else if (keyword == "param")
+			{
+				if (m_Tokens.size() < 3) return Error("Expected 'param <Name> vec4|mat4 <value>'");
+
+				Parameter parameter;
+				parameter.Name = NextToken();
+				const std::string type = NextToken();
+				if (m_Scene.FindParameter(parameter.Name) != nullptr) return Error("Parameter defined twice");
+
+				Value value;
+				if (type == "vec4")
+				{
+					parameter.Type = ValueType::Vec4;
+					if (!ReadVector(value) || value.IsParameter()) return Error("Expected a literal vec4");
+					parameter.DefaultVector = value.VectorValue;
+				}
+				else if (type == "mat4")
+				{
+					parameter.Type = ValueType::Mat4;
+					if (!ReadMatrix(value) || value.IsParameter()) return Error("Expected a literal mat4");
+					parameter.DefaultMatrix = value.MatrixValue;
+				}
+				else
+				{
+					return Error("Parameters are either vec4 or mat4");
+				}
+				m_Scene.Parameters.push_back(parameter);
+			}
+			else if (keyword == "bounds")
+			{
+				if (!ReadVector(m_Scene.BoundsOrigin) || !ReadFloat(m_Scene.BoundsRadius)) return false;
+			}
+			else if (keyword == "box" || keyword == "hypersphere")
+			{
+				statement.Op = (keyword == "box") ? OpCode::Box : OpCode::HyperSphere;
+				const bool valid = (statement.Op == OpCode::Box) ? ReadVector(statement.A) : ReadFloat(statement.Scalar);
+				if (!valid || !ReadMaterial(statement)) return false;
+				m_DistanceDepth++;
+			}
+			else if (keyword == "translate" || keyword == "repeat")
+			{
+				statement.Op = (keyword == "translate") ? OpCode::Translate : OpCode::Repeat;
+				if (!ReadVector(statement.A)) return false;
+				m_PositionDepth++;
+			}
+			else if (keyword == "repeat_finite")
+			{
+				statement.Op = OpCode::RepeatFinite;
+				if (!ReadVector(statement.A) || !ReadVector(statement.B)) return false;
+				m_PositionDepth++;
+			}
+			else if (keyword == "transform")
+			{
+				statement.Op = OpCode::Transform;
+				if (!ReadMatrix(statement.A)) return false;
+				m_PositionDepth++;
+			}
+			else if (keyword == "pop")
+			{
+				statement.Op = OpCode::Pop;
+				if (m_PositionDepth-- <= 0) return Error("'pop' without a position modifier");
+			}
+			else if (keyword == "onion")
+			{
+				statement.Op = OpCode::Onion;
+				if (m_DistanceDepth < 1) return Error("'onion' needs a subtree");
+				if (!ReadFloat(statement.Scalar)) return false;
+			}
+			else
+			{
+				static const std::map<std::string, OpCode> booleans = {
+					{"union", OpCode::Union}, {"intersection", OpCode::Intersection}, {"subtraction", OpCode::Subtraction},
+					{"smooth_union", OpCode::SmoothUnion}, {"smooth_intersection", OpCode::SmoothIntersection}, {"smooth_subtraction", OpCode::SmoothSubtraction},
+				};
+
+				const auto boolean = booleans.find(keyword);
+				if (boolean == booleans.end()) return Error("Unknown statement");
+
+				statement.Op = boolean->second;
+				if (m_DistanceDepth < 2) return Error("Booleans need two subtrees");
+				if (keyword.rfind("smooth_", 0) == 0 && !ReadFloat(statement.Scalar)) return false;
+				m_DistanceDepth--;
+			}
+
+			if (keyword != "scene" && keyword != "param" && keyword != "bounds")
+			{
+				m_Scene.Statements.push_back(statement);
+			}
+
+			return !HasToken() || Error("Unexpected tokens at the end of the line");
+		}
+
+		//////////////////////////////////////////////////////////////////////////
+
+		SceneDescription&			m_Scene;
+		std::vector<std::string>	m_Tokens;
+		size_t						m_Cursor		= 0;
+		int							m_Line			= 0;
+		int							m_PositionDepth	= 0;
+		int							m_DistanceDepth	= 0;
+	};
+
+	//////////////////////////////////////////////////////////////////////////
+	// Code generation
+	//////////////////////////////////////////////////////////////////////////
+
+	enum class Output { Distance, LocalPosition, Material };
+
+	// Records the tree first and emits code on demand afterwards, so that each body only contains the positions and distances
+	// its output depends on. The local position and material bodies only need the distances that feed the selects of booleans.
+	class BodyGenerator
+	{
+	public:
+		BodyGenerator(const SceneDescription& scene, const Output output) : m_Scene(scene), m_Output(output) {}
+
+		std::string Generate()
+		{
+			// Position p0 is the function argument.
+			m_Positions.push_back(PositionVariable{"position", -1, nullptr, Matrix(), Vector(), true, 0});
+			std::vector<int> positionStack = {0};
+			std::vector<int> distanceStack;
+
+			for (const Statement& statement : m_Scene.Statements)
+			{
+				const int current = positionStack.back();
+				switch (statement.Op)
+				{
+					case OpCode::Box:
+					case OpCode::HyperSphere:
+					{
+						distanceStack.push_back(AddDistance(statement, current, -1, -1));
+						break;
+					}
+					case OpCode::Translate:
+					{
+						if (statement.A.IsParameter())
+						{
+							const std::string translation = statement.A.MemberName();
+							positionStack.push_back(Define(current, [translation](const std::string& p) { return p + " - " + translation; }));
+						}
+						else
+						{
+							positionStack.push_back(Fold(current, Matrix(), Vector() - statement.A.VectorValue));
+						}
+						break;
+					}
+					case OpCode::Transform:
+					{
+						if (statement.A.IsParameter())
+						{
+							const std::string transformation = statement.A.MemberName();
+							positionStack.push_back(Define(current, [transformation](const std::string& p) { return transformation + " * " + p; }));
+						}
+						else
+						{
+							positionStack.push_back(Fold(current, statement.A.MatrixValue, Vector()));
+						}
+						break;
+					}
+					case OpCode::Repeat:
+					{
+						const std::string spacing = statement.A.IsParameter() ? statement.A.MemberName() : ToString(statement.A.VectorValue);
+						positionStack.push_back(Define(current, [spacing](const std::string& p) { return "glm::mod(" + p + " + 0.5f * " + spacing + ", " + spacing + ") - 0.5f * " + spacing; }));
+						break;
+					}
+					case OpCode::RepeatFinite:
+					{
+						const std::string spacing	= statement.A.IsParameter() ? statement.A.MemberName() : ToString(statement.A.VectorValue);
+						const std::string span		= statement.B.IsParameter() ? statement.B.MemberName() : ToString(statement.B.VectorValue);
+						positionStack.push_back(Define(current, [spacing, span](const std::string& p) { return p + " - " + spacing + " * glm::clamp(glm::round(" + p + " / " + spacing + "), -" + span + ", " + span + ")"; }));
+						break;
+					}
+					case OpCode::Pop:
+					{
+						positionStack.pop_back();
+						break;
+					}
+					case OpCode::Onion:
+					{
+						const int source = distanceStack.back();
+						distanceStack.pop_back();
+						distanceStack.push_back(AddDistance(statement, -1, source, -1));
+						break;
+					}
+					default:
+					{
+						const int rhs = distanceStack.back();
+						distanceStack.pop_back();
+						const int lhs = distanceStack.back();
+						distanceStack.pop_back();
+						distanceStack.push_back(AddDistance(statement, -1, lhs, rhs));
+						break;
+					}
+				}
+			}
+
+			const int result = distanceStack.back();
+			Emit("return " + (m_Output == Output::Distance ? RequireDistance(result) : RequireTracked(result)) + ";");
+			return m_Body;
+		}
+
+	private:
+
+		// A position that is either defined by an expression of its base position or pending as (Transformation * Base + Offset).
+		struct PositionVariable
+		{
+			std::string									Name;
+			int											Base;
+			std::function<std::string(const std::string&)>	Expression;
+			Matrix										Transformation;
+			Vector										Offset;
+			bool										IsEmitted;
+			int											UseCount;	// < Positions and primitives that are based on this one.
+
+			bool IsPending() const { return !IsEmitted && !Expression; }
+		};
+
+		// A primitive (Position) or an operation on the distances LHS and RHS. Every part of it is emitted at most once.
+		struct DistanceVariable
+		{
+			const Statement*	Source;
+			int					Position;
+			int					LHS;
+			int					RHS;
+			bool				IsDistanceEmitted	= false;
+			bool				IsWeightEmitted		= false;
+			bool				IsSelectEmitted		= false;
+			std::string			Tracked;	// < Name or literal of the local position or material, once emitted.
+		};
+
+		void Emit(const std::string& line)
+		{
+			m_Body += "\t\t" + line + "\n";
+		}
+
+		int Define(const int current, const std::function<std::string(const std::string&)>& expression)
+		{
+			m_Positions[current].UseCount++;
+			m_Positions.push_back(PositionVariable{"p" + std::to_string(m_Positions.size()), current, expression, Matrix(), Vector(), false, 0});
+			return static_cast<int>(m_Positions.size()) - 1;
+		}
+
+		// Literal translations and transformations stay pending and are folded into each other when the position is materialized.
+		int Fold(const int current, const Matrix& transformation, const Vector& offset)
+		{
+			m_Positions[current].UseCount++;
+			m_Positions.push_back(PositionVariable{"p" + std::to_string(m_Positions.size()), current, nullptr, transformation, offset, false, 0});
+			return static_cast<int>(m_Positions.size()) - 1;
+		}
+
+		std::string Materialize(const int index)
+		{
+			PositionVariable& variable = m_Positions[index];
+			if (variable.IsEmitted)
+			{
+				return variable.Name;
+			}
+
+			if (variable.Expression)
+			{
+				Emit("const glm::vec4 " + variable.Name + " = " + variable.Expression(Materialize(variable.Base)) + ";");
+				variable.IsEmitted = true;
+				return variable.Name;
+			}
+
+			// Pending bases that nothing else derives from are folded in. Shared ones are emitted once and only the own
+			// transformation of this position is applied to them, instead of repeating the combined one for every sibling.
+			Matrix transformation	= variable.Transformation;
+			Vector offset			= variable.Offset;
+			int base				= variable.Base;
+			while (m_Positions[base].IsPending() && m_Positions[base].UseCount == 1)
+			{
+				offset			= transformation * m_Positions[base].Offset + offset;
+				transformation	= transformation * m_Positions[base].Transformation;
+				base			= m_Positions[base].Base;
+			}
+
+			const std::string baseName = Materialize(base);
+			if (transformation.IsIdentity() && offset.IsZero())
+			{
+				// Identity nodes do not emit anything, they alias their base position.
+				variable.Name = baseName;
+			}
+			else
+			{
+				std::string expression = transformation.IsIdentity() ? baseName : ToString(transformation) + " * " + baseName;
+				if (!offset.IsZero()) expression += " + " + ToString(offset);
+				Emit("const glm::vec4 " + variable.Name + " = " + expression + ";");
+			}
+			variable.IsEmitted = true;
+			return variable.Name;
+		}
+
+		int AddDistance(const Statement& statement, const int position, const int lhs, const int rhs)
+		{
+			if (position >= 0) m_Positions[position].UseCount++;
+			m_Distances.push_back(DistanceVariable{&statement, position, lhs, rhs, false, false, false, ""});
+			return static_cast<int>(m_Distances.size()) - 1;
+		}
+
+		static bool IsSmooth(const OpCode op)
+		{
+			return op == OpCode::SmoothUnion || op == OpCode::SmoothIntersection || op == OpCode::SmoothSubtraction;
+		}
+
+		std::string RequireDistance(const int index)
+		{
+			DistanceVariable& variable	= m_Distances[index];
+			const std::string name		= "d" + std::to_string(index);
+			if (variable.IsDistanceEmitted)
+			{
+				return name;
+			}
+
+			const Statement& statement = *variable.Source;
+			switch (statement.Op)
+			{
+				case OpCode::Box:
+				{
+					const std::string position	= Materialize(variable.Position);
+					const std::string extents	= statement.A.IsParameter() ? statement.A.MemberName() : ToString(statement.A.VectorValue);
+					const std::string q			= "q" + std::to_string(index);
+					Emit("const glm::vec4 " + q + " = Math::Abs(" + position + ") - " + extents + ";");
+					Emit("const float " + name + " = Math::Min(Math::MaxComponent(" + q + "), 0.0f) + Math::Length(Math::Max(" + q + ", glm::vec4(0.0f)));");
+					break;
+				}
+				case OpCode::HyperSphere:
+				{
+					Emit("const float " + name + " = Math::Length(" + Materialize(variable.Position) + ") - " + ToString(statement.Scalar) + ";");
+					break;
+				}
+				case OpCode::Onion:
+				{
+					Emit("const float " + name + " = Math::Abs(" + RequireDistance(variable.LHS) + ") - " + ToString(statement.Scalar) + ";");
+					break;
+				}
+				default:
+				{
+					const std::string lhs	= RequireDistance(variable.LHS);
+					const std::string rhs	= RequireDistance(variable.RHS);
+					const std::string h		= IsSmooth(statement.Op) ? RequireWeight(index) : "";
+					const std::string k		= ToString(statement.Scalar);
+
+					std::string distance;
+					switch (statement.Op)
+					{
+						case OpCode::Union:					distance = "Math::Min(" + lhs + ", " + rhs + ")";													break;
+						case OpCode::Intersection:			distance = "Math::Max(" + lhs + ", " + rhs + ")";													break;
+						case OpCode::Subtraction:			distance = "Math::Max(-" + lhs + ", " + rhs + ")";													break;
+						case OpCode::SmoothUnion:			distance = "Math::UnclampedLerp(" + rhs + ", " + lhs + ", " + h + ") - " + k + " * " + h + " * (1.0f - " + h + ")";	break;
+						case OpCode::SmoothIntersection:	distance = "Math::UnclampedLerp(" + rhs + ", " + lhs + ", " + h + ") + " + k + " * " + h + " * (1.0f - " + h + ")";	break;
+						default:							distance = "Math::UnclampedLerp(" + rhs + ", -" + lhs + ", " + h + ") + " + k + " * " + h + " * (1.0f - " + h + ")";	break;
+					}
+					Emit("const float " + name + " = " + distance + ";");
+					break;
+				}
+			}
+
+			variable.IsDistanceEmitted = true;
+			return name;
+		}
+
+		// Smooth booleans: the weight of the lhs (negated for the subtraction) is h for all of them.
+		std::string RequireWeight(const int index)
+		{
+			DistanceVariable& variable	= m_Distances[index];
+			const std::string name		= "h" + std::to_string(index);
+			if (variable.IsWeightEmitted)
+			{
+				return name;
+			}
+
+			const std::string lhs	= RequireDistance(variable.LHS);
+			const std::string rhs	= RequireDistance(variable.RHS);
+			const std::string k		= ToString(variable.Source->Scalar);
+			switch (variable.Source->Op)
+			{
+				case OpCode::SmoothUnion:			Emit("const float " + name + " = Math::Clamp01(0.5f + 0.5f * (" + rhs + " - " + lhs + ") / " + k + ");");	break;
+				case OpCode::SmoothIntersection:	Emit("const float " + name + " = Math::Clamp01(0.5f - 0.5f * (" + rhs + " - " + lhs + ") / " + k + ");");	break;
+				default:							Emit("const float " + name + " = Math::Clamp01(0.5f - 0.5f * (" + lhs + " + " + rhs + ") / " + k + ");");	break;
+			}
+
+			variable.IsWeightEmitted = true;
+			return name;
+		}
+
+		// Whether a boolean takes the local position and material of its lhs.
+		std::string RequireSelect(const int index)
+		{
+			DistanceVariable& variable	= m_Distances[index];
+			const std::string name		= "s" + std::to_string(index);
+			if (variable.IsSelectEmitted)
+			{
+				return name;
+			}
+
+			std::string select;
+			if (IsSmooth(variable.Source->Op))
+			{
+				select = RequireWeight(index) + " >= 0.5f";
+			}
+			else
+			{
+				const std::string lhs = RequireDistance(variable.LHS);
+				const std::string rhs = RequireDistance(variable.RHS);
+				switch (variable.Source->Op)
+				{
+					case OpCode::Union:			select = lhs + " <= " + rhs;		break;
+					case OpCode::Intersection:	select = lhs + " >= " + rhs;		break;
+					default:					select = "-" + lhs + " >= " + rhs;	break;
+				}
+			}
+			Emit("const bool " + name + " = " + select + ";");
+
+			variable.IsSelectEmitted = true;
+			return name;
+		}
+
+		// The local position or the material, depending on the output.
+		std::string RequireTracked(const int index)
+		{
+			DistanceVariable& variable = m_Distances[index];
+			if (!variable.Tracked.empty())
+			{
+				return variable.Tracked;
+			}
+
+			switch (variable.Source->Op)
+			{
+				case OpCode::Box:
+				case OpCode::HyperSphere:
+				{
+					variable.Tracked = (m_Output == Output::LocalPosition) ? Materialize(variable.Position) : std::to_string(variable.Source->Material);
+					break;
+				}
+				case OpCode::Onion:
+				{
+					variable.Tracked = RequireTracked(variable.LHS);
+					break;
+				}
+				default:
+				{
+					const std::string select	= RequireSelect(index);
+					const std::string lhs		= RequireTracked(variable.LHS);
+					const std::string rhs		= RequireTracked(variable.RHS);
+					const std::string name		= (m_Output == Output::LocalPosition ? "l" : "m") + std::to_string(index);
+					Emit((m_Output == Output::LocalPosition ? "const glm::vec4 " : "const int ") + name + " = " + select + " ? " + lhs + " : " + rhs + ";");
+					variable.Tracked = name;
+					break;
+				}
+			}
+
+			return variable.Tracked;
+		}
+
+		//////////////////////////////////////////////////////////////////////////
+
+		const SceneDescription&			m_Scene;
+		const Output					m_Output;
+		std::string						m_Body;
+		std::vector<PositionVariable>	m_Positions;
+		std::vector<DistanceVariable>	m_Distances;
+	};
+
+	//////////////////////////////////////////////////////////////////////////
+
+	std::string GenerateHeader(const SceneDescription& scene, const std::string& sourceName)
+	{
+		const std::string separator = "\t//////////////////////////////////////////////////////////////////////////\n\n";
+
+		std::string header;
+		header += "#pragma once\n\n";
+		header += "// Generated by Tools/SceneCodeGenerator from " + sourceName + ". Do not edit, regenerate instead.\n\n";
+		header += "#include \"Rendering/Scenes/Scene.h\"\n\n";
+		header += "#include \"MathLib/MathLib.h\"\n";
+		header += "#include \"MathLib/SignedDistanceFields/SignedDistanceField.h\"\n\n";
+		header += "class A_CPUGPU_ALIGN(16) " + scene.ClassName + " : public Scene<glm::vec4>\n{\npublic:\n";
+		header += "\tusing N = glm::vec4;\n\n";
+		header += "\tvoid Init() {}\n\tvoid UnInit() {}\n\n";
+		header += separator;
+
+		header += "\tA_CUDA_CPUGPU float EvaluateDistance(const glm::vec4& position) const\n\t{\n";
+		header += BodyGenerator(scene, Output::Distance).Generate();
+		header += "\t}\n\n" + separator;
+
+		header += "\tA_CUDA_CPUGPU glm::vec4 GetLocalSamplePosition(const glm::vec4& position) const\n\t{\n";
+		header += BodyGenerator(scene, Output::LocalPosition).Generate();
+		header += "\t}\n\n" + separator;
+
+		header += "\t// Material id of the primitive that is closest to the position.\n";
+		header += "\tA_CUDA_CPUGPU int GetMaterialID(const glm::vec4& position) const\n\t{\n";
+		header += BodyGenerator(scene, Output::Material).Generate();
+		header += "\t}\n\n" + separator;
+
+		header += "\tA_CUDA_CPUGPU glm::vec4 EvaluateNormal(const glm::vec4& position) const\n\t{\n";
+		header += "\t\treturn Math::SampleNormal(*this, position);\n\t}\n\n" + separator;
+
+		header += "\tA_CUDA_CPUGPU glm::vec4 EvaluateToSurfaceVector(const glm::vec4& position, float& outDistance) const\n\t{\n";
+		header += "\t\treturn Math::EvaluateToSurfaceVector(*this, position, outDistance);\n\t}\n\n" + separator;
+
+		header += "\tA_CUDA_CPUGPU glm::vec4 EvaluateToSurfaceVectorZW(const glm::vec4& position, float& outDistance) const\n\t{\n";
+		header += "\t\treturn Math::EvaluateToSurfaceVectorZW(*this, position, outDistance);\n\t}\n\n" + separator;
+
+		header += "\tA_CUDA_CPUGPU glm::vec4 EvaluateToSurfaceVectorZWFromDistance(const glm::vec4& position, const float distance) const\n\t{\n";
+		header += "\t\treturn Math::EvaluateToSurfaceVectorZWFromDistance(*this, position, distance);\n\t}\n\n" + separator;
+
+		const std::string boundsOrigin = scene.BoundsOrigin.IsParameter() ? scene.BoundsOrigin.MemberName() : ToString(scene.BoundsOrigin.VectorValue);
+		header += "\tMath::Hypershere GetBoundingHypersphere() const\n\t{\n";
+		header += "\t\treturn Math::Hypershere(" + boundsOrigin + ", " + ToString(scene.BoundsRadius) + ");\n\t}\n";
+
+		if (!scene.Parameters.empty())
+		{
+			header += "\n" + separator;
+		}
+
+		for (const Parameter& parameter : scene.Parameters)
+		{
+			const std::string type = parameter.Type == ValueType::Vec4 ? "glm::vec4" : "glm::mat4";
+			header += "\tA_CUDA_CPUGPU void Set" + parameter.Name + "(const " + type + "& value) { m_" + parameter.Name + " = value; }\n";
+			header += "\tA_CUDA_CPUGPU const " + type + "& Get" + parameter.Name + "() const { return m_" + parameter.Name + "; }\n";
+		}
+
+		header += "\nprivate:\n";
+		for (const Parameter& parameter : scene.Parameters)
+		{
+			const std::string type		= parameter.Type == ValueType::Vec4 ? "glm::vec4" : "glm::mat4";
+			const std::string value		= parameter.Type == ValueType::Vec4 ? ToString(parameter.DefaultVector) : ToString(parameter.DefaultMatrix);
+			header += "\t" + type + " m_" + parameter.Name + " = " + value + ";\n";
+		}
+		header += "};\n";
+
+		return header;
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char* argv[])
+{
+	if (argc != 3)
+	{
+		printf("Usage: SceneCodeGenerator <input.scene> <output.h>\n");
+		return 1;
+	}
+
+	std::ifstream input(argv[1]);
+	if (!input)
+	{
+		printf("Error: Could not open %s\n", argv[1]);
+		return 1;
+	}
+
+	SceneDescription scene;
+	if (!Parser(scene).Parse(input))
+	{
+		return 1;
+	}
+
+	std::string sourceName = argv[1];
+	const size_t slash = sourceName.find_last_of("/\\");
+	if (slash != std::string::npos) sourceName.erase(0, slash + 1);
+
+	std::ofstream output(argv[2], std::ios::binary);
+	output << GenerateHeader(scene, sourceName);
+	if (!output)
+	{
+		printf("Error: Could not write %s\n", argv[2]);
+		return 1;
+	}
+
+	printf("Generated %s (%zu statements)\n", argv[2], scene.Statements.size());
+	return 0;
+}